@@ -0,0 +1,100 @@
+/*
+    Implementation for module which provides a bump allocator.
+
+    Blocks are kept in a list, newest first, and allocations are cut
+        from the newest block in order. Each block is at least twice
+        the size of the one before it, so an arena holding n bytes
+        needs only O(log n) blocks.
+*/
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "arena.h"
+
+/* Alignment of every allocation, one cache line. */
+#define ARENAALIGNMENT 64
+
+/* Size of the first block. */
+#define INITIALBLOCKSIZE 16384
+
+/* Rounds size up to a multiple of the alignment. */
+#define ALIGNUP(size) (((size) + ARENAALIGNMENT - 1) / ARENAALIGNMENT * ARENAALIGNMENT)
+
+struct arenaBlock {
+    struct arenaBlock *next;
+    /* Bytes in the block after its header. */
+    size_t size;
+    /* Bytes handed out so far. */
+    size_t used;
+};
+
+/* Space the header takes at the start of each block, keeping data aligned. */
+#define BLOCKHEADERSIZE ALIGNUP(sizeof(struct arenaBlock))
+
+struct arena {
+    /* The block allocations are cut from, followed by older blocks. */
+    struct arenaBlock *blocks;
+    /* Start of the last allocation, which can be grown in place. */
+    char *last;
+};
+
+/* Start of the memory handed out from the given block. */
+static char *blockData(struct arenaBlock *b){
+    return ((char *) b) + BLOCKHEADERSIZE;
+}
+
+struct arena *newArena(){
+    struct arena *a = (struct arena *) malloc(sizeof(struct arena));
+    assert(a);
+    a->blocks = NULL;
+    a->last = NULL;
+    return a;
+}
+
+void *arenaAlloc(struct arena *a, size_t size){
+    size = ALIGNUP(size);
+    struct arenaBlock *b = a->blocks;
+    if(! b || b->size - b->used < size){
+        size_t blockSize = b ? b->size * 2 : INITIALBLOCKSIZE;
+        while(blockSize < size){
+            blockSize *= 2;
+        }
+        b = (struct arenaBlock *) aligned_alloc(ARENAALIGNMENT, BLOCKHEADERSIZE + blockSize);
+        assert(b);
+        b->next = a->blocks;
+        b->size = blockSize;
+        b->used = 0;
+        a->blocks = b;
+    }
+    a->last = blockData(b) + b->used;
+    b->used += size;
+    return a->last;
+}
+
+void *arenaGrow(struct arena *a, void *ptr, size_t oldSize, size_t newSize){
+    struct arenaBlock *b = a->blocks;
+    if(ptr && ptr == a->last){
+        size_t start = a->last - blockData(b);
+        if(start + ALIGNUP(newSize) <= b->size){
+            b->used = start + ALIGNUP(newSize);
+            return ptr;
+        }
+    }
+    void *grown = arenaAlloc(a, newSize);
+    if(ptr){
+        memcpy(grown, ptr, oldSize < newSize ? oldSize : newSize);
+    }
+    return grown;
+}
+
+void freeArena(struct arena *a){
+    if(a){
+        struct arenaBlock *b = a->blocks;
+        while(b){
+            struct arenaBlock *next = b->next;
+            free(b);
+            b = next;
+        }
+        free(a);
+    }
+}
@@ -0,0 +1,27 @@
+/*
+    Header for module which provides a bump allocator, handing out
+        memory from a few large blocks which are all freed at once.
+*/
+#include <stddef.h>
+
+struct arena;
+
+/* Creates an empty arena. No block is allocated until memory is asked for. */
+struct arena *newArena();
+
+/*
+    Allocates size bytes from the arena, aligned to a cache line. The
+    memory is only freed along with the arena. Arenas aren't safe to
+    allocate from on more than one thread at once.
+*/
+void *arenaAlloc(struct arena *a, size_t size);
+
+/*
+    Grows the given allocation of oldSize bytes to newSize bytes, in
+    place if it was the last allocation and its block has room, and
+    otherwise by copying it to a fresh allocation.
+*/
+void *arenaGrow(struct arena *a, void *ptr, size_t oldSize, size_t newSize);
+
+/* Frees the given arena and every allocation made from it. */
+void freeArena(struct arena *a);
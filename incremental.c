@@ -0,0 +1,453 @@
+/*
+    Implementation for module which keeps a document solved as in
+        Part F while its text is edited.
+
+    Every term keeps the position its term search started from, its
+        DP column, its backpointers and its colour on the best path.
+        An edit only changes the terms whose search read the edited
+        text, found from the first of them until a search starts at
+        the same place in the text after the edit as an old one did.
+
+    DP columns are kept less their lowest reachable score, with that
+        lowest score kept as the gain over the column before, so the
+        whole score is the sum of the gains. Once a column found again
+        after the edit matches its old one, every later column is its
+        old one plus a constant, so only the gains to the edit change.
+        The best path after that column is also unchanged, and before
+        the edit it's followed back only until it rejoins the old path.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include "problemInternal.h"
+#include "termHash.h"
+#include "maxPlus.h"
+#include "problemStruct.c"
+#include "solutionStruct.c"
+#include "incremental.h"
+
+/* Number of terms and characters to allocate space for initially. */
+#define INITIALTERMS 64
+#define INITIALTEXT 4096
+
+struct incrementalDocument {
+    /* Holds the model, text and terms for the shared term and DP functions. */
+    struct problem *p;
+    int colourCount;
+    /* 1 if no sum can fall to DEFAULTSCORE, so columns converge to their old ones. */
+    int linear;
+
+    char *text;
+    int textLength;
+    int textAllocated;
+
+    int termCount;
+    int termsAllocated;
+    struct termSpan *terms;
+    /*
+        Where the search for each term started, with scans[termCount]
+        where the search after the last term started.
+    */
+    int *scans;
+    /* DP column of each term, less its lowest reachable score. */
+    int *columns;
+    /* The lowest reachable score of each term's column less that of the term before. */
+    int *gains;
+    /* The sum of the gains, the lowest reachable score of the last column. */
+    int totalGain;
+    /* Backpointers of each term after the first, as in solveProblemF. */
+    uint16_t *backpointers;
+
+    /* Terms found again by the current edit, before they are put in place. */
+    struct termSpan *newTerms;
+    int *newScans;
+    int newTermsAllocated;
+
+    /* Scratch columns for each DP step. */
+    int *prevColumn;
+    int *column;
+    int *from;
+
+    /* The colours of the best path, and the solution over them. */
+    int *colours;
+    struct solution solution;
+};
+
+/* Checks whether any sum in the DP over the given model can fall to DEFAULTSCORE. */
+static int isLinear(struct model *m){
+    int colourCount = m->colourCount;
+    for(int i = 0; i < colourCount * colourCount; i++){
+        if(m->colourTransitionTable->matrix[i] < 0){
+            return 0;
+        }
+    }
+    for(int t = 0; t < m->termColourTableCount; t++){
+        for(int c = 0; c < colourCount; c++){
+            if(m->colourTables[t].scores[c] < DEFAULTSCORE){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+struct incrementalDocument *newIncrementalDocument(struct model *m, const char *text,
+    int length){
+    assert(m->colourTransitionTable);
+    assert(m->colourCount <= UINT16_MAX + 1);
+    struct incrementalDocument *d = (struct incrementalDocument *) malloc(sizeof(struct incrementalDocument));
+    assert(d);
+    d->p = newProblem();
+    d->p->part = PART_F;
+    d->p->model = m;
+    d->colourCount = m->colourCount;
+    d->linear = isLinear(m);
+
+    d->textAllocated = INITIALTEXT;
+    d->text = (char *) malloc(sizeof(char) * d->textAllocated);
+    assert(d->text);
+    d->text[0] = '\0';
+    d->textLength = 0;
+
+    d->termCount = 0;
+    d->termsAllocated = INITIALTERMS;
+    d->terms = (struct termSpan *) malloc(sizeof(struct termSpan) * d->termsAllocated);
+    assert(d->terms);
+    d->scans = (int *) malloc(sizeof(int) * (d->termsAllocated + 1));
+    assert(d->scans);
+    d->scans[0] = 0;
+    d->columns = (int *) malloc(sizeof(int) * d->termsAllocated * d->colourCount);
+    assert(d->columns);
+    d->gains = (int *) malloc(sizeof(int) * d->termsAllocated);
+    assert(d->gains);
+    d->totalGain = 0;
+    d->backpointers = (uint16_t *) malloc(sizeof(uint16_t) * d->termsAllocated * d->colourCount);
+    assert(d->backpointers);
+    d->colours = (int *) malloc(sizeof(int) * d->termsAllocated);
+    assert(d->colours);
+
+    d->newTermsAllocated = INITIALTERMS;
+    d->newTerms = (struct termSpan *) malloc(sizeof(struct termSpan) * d->newTermsAllocated);
+    assert(d->newTerms);
+    d->newScans = (int *) malloc(sizeof(int) * d->newTermsAllocated);
+    assert(d->newScans);
+
+    d->prevColumn = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->prevColumn);
+    d->column = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->column);
+    d->from = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->from);
+
+    d->solution.termCount = 0;
+    d->solution.termColours = d->colours;
+    d->solution.score = DEFAULTSCORE;
+
+    /* The document starts empty, with the whole text as its first edit. */
+    incrementalEdit(d, 0, 0, text, length);
+    return d;
+}
+
+/* Makes room for at least count terms. */
+static void reserveTerms(struct incrementalDocument *d, int count){
+    if(count <= d->termsAllocated){
+        return;
+    }
+    while(d->termsAllocated < count){
+        d->termsAllocated = d->termsAllocated * 2;
+    }
+    size_t cells = (size_t) d->termsAllocated * d->colourCount;
+    d->terms = (struct termSpan *) realloc(d->terms, sizeof(struct termSpan) * d->termsAllocated);
+    assert(d->terms);
+    d->scans = (int *) realloc(d->scans, sizeof(int) * (d->termsAllocated + 1));
+    assert(d->scans);
+    d->columns = (int *) realloc(d->columns, sizeof(int) * cells);
+    assert(d->columns);
+    d->gains = (int *) realloc(d->gains, sizeof(int) * d->termsAllocated);
+    assert(d->gains);
+    d->backpointers = (uint16_t *) realloc(d->backpointers, sizeof(uint16_t) * cells);
+    assert(d->backpointers);
+    d->colours = (int *) realloc(d->colours, sizeof(int) * d->termsAllocated);
+    assert(d->colours);
+    d->solution.termColours = d->colours;
+}
+
+/* Applies the edit to the text itself. */
+static void editText(struct incrementalDocument *d, int start, int deleteLength,
+    const char *insert, int insertLength){
+    int length = d->textLength - deleteLength + insertLength;
+    if(length + 1 > d->textAllocated){
+        while(length + 1 > d->textAllocated){
+            d->textAllocated = d->textAllocated * 2;
+        }
+        d->text = (char *) realloc(d->text, sizeof(char) * d->textAllocated);
+        assert(d->text);
+    }
+    memmove(d->text + start + insertLength, d->text + start + deleteLength,
+        d->textLength - start - deleteLength);
+    memcpy(d->text + start, insert, insertLength);
+    d->textLength = length;
+    d->text[length] = '\0';
+}
+
+/*
+    Finds the first term whose search could have read text from start
+    onwards. A search reads up to where the next one starts, and the
+    trie may look as far as the longest term past where the term starts.
+    Both only grow from term to term, so this is a binary search.
+*/
+static int firstChangedTerm(struct incrementalDocument *d, int start){
+    int maxTermLength = d->p->model->maxTermLength;
+    int low = 0;
+    int high = d->termCount;
+    while(low < high){
+        int mid = low + (high - low) / 2;
+        int readEnd = d->scans[mid + 1];
+        if(d->terms[mid].start + maxTermLength > readEnd){
+            readEnd = d->terms[mid].start + maxTermLength;
+        }
+        if(readEnd >= start){
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+/* Adds a term found again by the current edit. */
+static void addNewTerm(struct incrementalDocument *d, int count, struct termSpan *term,
+    int scan){
+    if(count >= d->newTermsAllocated){
+        d->newTermsAllocated = d->newTermsAllocated * 2;
+        d->newTerms = (struct termSpan *) realloc(d->newTerms, sizeof(struct termSpan) * d->newTermsAllocated);
+        assert(d->newTerms);
+        d->newScans = (int *) realloc(d->newScans, sizeof(int) * d->newTermsAllocated);
+        assert(d->newScans);
+    }
+    d->newTerms[count] = *term;
+    d->newScans[count] = scan;
+}
+
+/*
+    Replaces old terms first to *last - 1 with the terms found again
+    searching the edited text from where term first's search started.
+    The search stops at the end of the text, or once it reaches a place
+    past the edit where an old search started, setting *last to that old
+    term. Returns the number of terms found.
+*/
+static int retokenize(struct incrementalDocument *d, int first, int *last, int start,
+    int deleteLength, int insertLength){
+    int shift = insertLength - deleteLength;
+    int position = d->scans[first];
+    int old = first;
+    int count = 0;
+    while(1){
+        if(position >= start + insertLength){
+            /* Past the edit, so an old search starting here found the same terms. */
+            while(old < d->termCount && d->scans[old] < position - shift){
+                old++;
+            }
+            if(d->scans[old] == position - shift){
+                break;
+            }
+        }
+        struct termSpan term;
+        int consumed = nextTerm(d->p, d->text + position, d->textLength - position, 1, &term);
+        if(term.length == 0){
+            /* Only trailing punctuation left. */
+            old = d->termCount;
+            break;
+        }
+        term.start += position;
+        addNewTerm(d, count, &term, position);
+        count++;
+        position += consumed;
+    }
+    *last = old;
+
+    /* Put the new terms in place of the old ones, moving the rest along. */
+    int termCount = first + count + d->termCount - old;
+    reserveTerms(d, termCount);
+    int colourCount = d->colourCount;
+    int moved = d->termCount - old;
+    for(int i = first; i < old; i++){
+        d->totalGain -= d->gains[i];
+    }
+    memmove(d->terms + first + count, d->terms + old, sizeof(struct termSpan) * moved);
+    memmove(d->scans + first + count + 1, d->scans + old + 1, sizeof(int) * moved);
+    memmove(d->columns + (size_t) (first + count) * colourCount, d->columns + (size_t) old * colourCount,
+        sizeof(int) * moved * colourCount);
+    memmove(d->gains + first + count, d->gains + old, sizeof(int) * moved);
+    memmove(d->backpointers + (size_t) (first + count) * colourCount,
+        d->backpointers + (size_t) old * colourCount, sizeof(uint16_t) * moved * colourCount);
+    memmove(d->colours + first + count, d->colours + old, sizeof(int) * moved);
+    for(int i = first + count; i < termCount; i++){
+        d->terms[i].start += shift;
+        d->scans[i + 1] += shift;
+    }
+    memcpy(d->terms + first, d->newTerms, sizeof(struct termSpan) * count);
+    memcpy(d->scans + first, d->newScans, sizeof(int) * count);
+    d->scans[first + count] = position;
+    for(int i = first; i < first + count; i++){
+        d->gains[i] = 0;
+    }
+    d->termCount = termCount;
+    return count;
+}
+
+/*
+    Finds the DP columns again from term first, stopping after the first
+    old term after the new ones whose column is unchanged. Returns the
+    last term whose column was found again.
+*/
+static int resolveColumns(struct incrementalDocument *d, int first, int oldFrom){
+    int colourCount = d->colourCount;
+    int *matrix = d->p->model->colourTransitionTable->matrix;
+    /*
+        Sums can't be made unreachable in a linear DP, so columns are
+        stepped without their gains. Otherwise they are stepped from
+        their actual scores.
+    */
+    int offset = 0;
+    if(! d->linear){
+        for(int i = 0; i < first; i++){
+            offset += d->gains[i];
+        }
+    }
+    for(int i = first; i < d->termCount; i++){
+        int *wc = getTableWCRow(d->p, d->terms[i].table);
+        int *column = d->column;
+        if(i == 0){
+            for(int c = 0; c < colourCount; c++){
+                column[c] = (wc[c] == DEFAULTSCORE) ? MAXPLUS_UNREACHABLE : wc[c];
+            }
+            offset = 0;
+        } else {
+            int *prev = d->columns + (size_t) (i - 1) * colourCount;
+            for(int c = 0; c < colourCount; c++){
+                d->prevColumn[c] = (prev[c] == MAXPLUS_UNREACHABLE) ? MAXPLUS_UNREACHABLE : prev[c] + offset;
+            }
+            maxPlusStepArgmax(d->prevColumn, matrix, wc, column, d->from, colourCount);
+        }
+        int lowest = offset;
+        int found = 0;
+        for(int c = 0; c < colourCount; c++){
+            if(column[c] != MAXPLUS_UNREACHABLE && (! found || column[c] < lowest)){
+                lowest = column[c];
+                found = 1;
+            }
+        }
+        for(int c = 0; c < colourCount; c++){
+            if(column[c] != MAXPLUS_UNREACHABLE){
+                column[c] -= lowest;
+            }
+        }
+
+        int *stored = d->columns + (size_t) i * colourCount;
+        int converged = d->linear && i >= oldFrom &&
+            memcmp(stored, column, sizeof(int) * colourCount) == 0;
+        memcpy(stored, column, sizeof(int) * colourCount);
+        if(i > 0){
+            uint16_t *entries = d->backpointers + (size_t) i * colourCount;
+            for(int c = 0; c < colourCount; c++){
+                entries[c] = (uint16_t) d->from[c];
+            }
+        }
+        d->totalGain += (lowest - offset) - d->gains[i];
+        d->gains[i] = lowest - offset;
+        if(! d->linear){
+            offset = lowest;
+        }
+        if(converged){
+            return i;
+        }
+    }
+    return d->termCount - 1;
+}
+
+void incrementalEdit(struct incrementalDocument *d, int start, int deleteLength,
+    const char *insert, int insertLength){
+    assert(start >= 0 && deleteLength >= 0 && start + deleteLength <= d->textLength);
+    int first = firstChangedTerm(d, start);
+    editText(d, start, deleteLength, insert, insertLength);
+    int last;
+    int count = retokenize(d, first, &last, start, deleteLength, insertLength);
+    d->p->text = d->text;
+    d->p->terms = d->terms;
+    d->p->termCount = d->termCount;
+    d->solution.termCount = d->termCount;
+
+    int converged = resolveColumns(d, first, first + count);
+    if(d->termCount == 0){
+        d->solution.score = DEFAULTSCORE;
+        return;
+    }
+    int lastTerm = d->termCount - 1;
+    int *column = d->columns + (size_t) lastTerm * d->colourCount;
+    int colour = bestDPColour(d->p, column);
+    if(colour != DEFAULTCOLOUR && column[colour] + d->totalGain <= DEFAULTSCORE){
+        /* Only its actual score counts, which can be below its stored one. */
+        colour = DEFAULTCOLOUR;
+    }
+    if(colour == DEFAULTCOLOUR){
+        for(int i = 0; i < d->termCount; i++){
+            d->colours[i] = DEFAULTCOLOUR;
+        }
+        d->solution.score = DEFAULTSCORE;
+        return;
+    }
+
+    /* Colours are unchanged from a converged column on, unless there were none. */
+    int from = converged;
+    if(converged == lastTerm || d->solution.score == DEFAULTSCORE){
+        from = lastTerm;
+        d->colours[lastTerm] = colour;
+    }
+    d->solution.score = column[colour] + d->totalGain;
+    for(int i = from; i > 0; i--){
+        int prevColour = d->backpointers[(size_t) i * d->colourCount + d->colours[i]];
+        if(i - 1 < first && d->colours[i - 1] == prevColour){
+            /* Rejoined the old path, which is unchanged before the edit. */
+            break;
+        }
+        d->colours[i - 1] = prevColour;
+    }
+}
+
+int incrementalTextLength(struct incrementalDocument *d){
+    return d->textLength;
+}
+
+struct problem *incrementalProblem(struct incrementalDocument *d){
+    return d->p;
+}
+
+struct solution *incrementalSolution(struct incrementalDocument *d){
+    return &(d->solution);
+}
+
+void freeIncrementalDocument(struct incrementalDocument *d){
+    if(! d){
+        return;
+    }
+    /* The text and terms belong to the document, not the problem's arena. */
+    d->p->text = NULL;
+    d->p->terms = NULL;
+    freeProblem(d->p);
+    free(d->text);
+    free(d->terms);
+    free(d->scans);
+    free(d->columns);
+    free(d->gains);
+    free(d->backpointers);
+    free(d->newTerms);
+    free(d->newScans);
+    free(d->prevColumn);
+    free(d->column);
+    free(d->from);
+    free(d->colours);
+    free(d);
+}
@@ -0,0 +1,55 @@
+/*
+    Header for module which keeps a document solved as in Part F
+        while its text is edited, re-solving only the terms an edit
+        changes rather than the whole text.
+*/
+#include "problem.h"
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+struct incrementalDocument;
+
+/*
+    Sets up a document holding the length characters of text, solved
+    according to Part F's definition against the given model, which
+    needs a colour transition table and must outlive the document.
+*/
+struct incrementalDocument *newIncrementalDocument(struct model *m, const char *text,
+    int length);
+
+/*
+    Replaces the deleteLength characters of the document's text from
+    start with the insertLength characters of insert, then re-solves it.
+    Only the terms near the edit are found again. DP columns are found
+    again from there until they match the old ones up to a constant,
+    after which nothing further can change, so an edit costs about its
+    own size. That only holds when no sum can be made unreachable by
+    falling to -1 or below, which holds when no transition is negative
+    or missing and no term scores below -1, as solveProblemEParallel
+    requires. Otherwise the columns after the edit are all found again.
+*/
+void incrementalEdit(struct incrementalDocument *d, int start, int deleteLength,
+    const char *insert, int insertLength);
+
+/* Returns the number of characters in the document's text. */
+int incrementalTextLength(struct incrementalDocument *d);
+
+/*
+    Returns the problem holding the document's text and terms, for
+    outputProblem, as it is until the next edit. It stays owned by the
+    document.
+*/
+struct problem *incrementalProblem(struct incrementalDocument *d);
+
+/*
+    Returns the solution of the document as solveProblemF would give it
+    for its text, with its score as solveProblemE would give it, as it
+    is until the next edit. It stays owned by the document.
+*/
+struct solution *incrementalSolution(struct incrementalDocument *d);
+
+/* Frees the given document and all memory allocated for it. */
+void freeIncrementalDocument(struct incrementalDocument *d);
+
+#endif
@@ -0,0 +1,207 @@
+/*
+    Implementation for module which finds the k best colourings of
+        a problem as in Part F.
+
+    Each DP cell keeps the k best scores of paths reaching its term
+        and colour, in order, with a backpointer to the colour and
+        rank of the cell entry before it. A cell's entries come from
+        merging the previous column's lists, each shifted by its
+        transition score. The lists are already in order, so a heap
+        holding the head of each one gives the k best in
+        O(colourCount + k log colourCount), and a whole column costs
+        little more than one Viterbi step until k nears colourCount.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+#include "problemInternal.h"
+#include "maxPlus.h"
+#include "arena.h"
+#include "problemStruct.c"
+#include "solutionStruct.c"
+#include "kBest.h"
+
+/* Head of one ranked list being merged. */
+struct kBestCandidate {
+    int score;
+    /* The colour of the list, and the rank of the entry in it. */
+    int colour;
+    int rank;
+};
+
+/*
+    Orders candidates best first, breaking ties on the lower colour and
+    then the lower rank, as the Viterbi argmax does.
+*/
+static int candidateBefore(const struct kBestCandidate *a, const struct kBestCandidate *b){
+    if(a->score != b->score){
+        return a->score > b->score;
+    }
+    if(a->colour != b->colour){
+        return a->colour < b->colour;
+    }
+    return a->rank < b->rank;
+}
+
+/* Moves the candidate at index i down the heap of size until it is in order. */
+static void siftDown(struct kBestCandidate *heap, int size, int i){
+    while(1){
+        int first = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if(left < size && candidateBefore(&heap[left], &heap[first])){
+            first = left;
+        }
+        if(right < size && candidateBefore(&heap[right], &heap[first])){
+            first = right;
+        }
+        if(first == i){
+            return;
+        }
+        struct kBestCandidate swap = heap[i];
+        heap[i] = heap[first];
+        heap[first] = swap;
+        i = first;
+    }
+}
+
+/* Puts the given candidates into heap order. */
+static void makeHeap(struct kBestCandidate *heap, int size){
+    for(int i = size / 2 - 1; i >= 0; i--){
+        siftDown(heap, size, i);
+    }
+}
+
+/*
+    Computes the ranked entries of term i for every colour from those of
+    term i - 1, where column[c * k + r] is the score of rank r for colour
+    c, or MAXPLUS_UNREACHABLE past the last entry. Scores follow the same
+    rules as maxPlusStep. back[c * k + r] is set to the entry of term i - 1
+    each comes from, as colour * k + rank.
+*/
+static void nextKBestColumn(struct problem *p, int i, int k, const int *prevColumn,
+    int *column, int *back, struct kBestCandidate *heap){
+    int colourCount = p->model->colourCount;
+    const int *matrix = p->model->colourTransitionTable->matrix;
+    const int *wc = getWCRow(p, i);
+    for(int c = 0; c < colourCount; c++){
+        int found = 0;
+        if(wc[c] != MAXPLUS_NO_SCORE){
+            /* Start from the best entry of each previous colour. */
+            int size = 0;
+            for(int j = 0; j < colourCount; j++){
+                if(prevColumn[j * k] != MAXPLUS_UNREACHABLE){
+                    heap[size].score = prevColumn[j * k] + matrix[j * colourCount + c];
+                    heap[size].colour = j;
+                    heap[size].rank = 0;
+                    size++;
+                }
+            }
+            makeHeap(heap, size);
+            while(found < k && size > 0){
+                struct kBestCandidate best = heap[0];
+                int score = best.score + wc[c];
+                if(score <= MAXPLUS_NO_SCORE){
+                    /* Every entry left scores no higher. */
+                    break;
+                }
+                column[c * k + found] = score;
+                back[c * k + found] = best.colour * k + best.rank;
+                found++;
+                /* Replace the entry taken with the next from its list. */
+                int rank = best.rank + 1;
+                if(rank < k && prevColumn[best.colour * k + rank] != MAXPLUS_UNREACHABLE){
+                    heap[0].score = prevColumn[best.colour * k + rank] +
+                        matrix[best.colour * colourCount + c];
+                    heap[0].rank = rank;
+                } else {
+                    size--;
+                    heap[0] = heap[size];
+                }
+                siftDown(heap, size, 0);
+            }
+        }
+        for(int r = found; r < k; r++){
+            column[c * k + r] = MAXPLUS_UNREACHABLE;
+        }
+    }
+}
+
+int solveProblemKBest(struct problem *p, int k, struct solution **solutions){
+    assert(k > 0);
+    assert(p->model->colourTransitionTable);
+    if(p->termCount == 0){
+        solutions[0] = newSolution(p);
+        return 1;
+    }
+    int colourCount = p->model->colourCount;
+    assert((long long) colourCount * k <= INT_MAX);
+    size_t cells = (size_t) colourCount * k;
+    int *column = (int *) arenaAlloc(p->arena, sizeof(int) * cells);
+    int *prevColumn = (int *) arenaAlloc(p->arena, sizeof(int) * cells);
+    /* Backpointers of terms 1 onwards, term i at (i - 1) * cells. */
+    int *back = (int *) arenaAlloc(p->arena, sizeof(int) * cells * (p->termCount - 1));
+    struct kBestCandidate *heap = (struct kBestCandidate *) arenaAlloc(p->arena,
+        sizeof(struct kBestCandidate) * colourCount);
+
+    /* The first term has one entry per colour, as in firstDPColumn. */
+    const int *wc = getWCRow(p, 0);
+    for(int c = 0; c < colourCount; c++){
+        column[c * k] = (wc[c] == DEFAULTSCORE) ? MAXPLUS_UNREACHABLE : wc[c];
+        for(int r = 1; r < k; r++){
+            column[c * k + r] = MAXPLUS_UNREACHABLE;
+        }
+    }
+    for(int i = 1; i < p->termCount; i++){
+        int *swap = prevColumn;
+        prevColumn = column;
+        column = swap;
+        nextKBestColumn(p, i, k, prevColumn, column, back + (size_t) (i - 1) * cells, heap);
+    }
+
+    /* Merge the last term's lists, keeping only scores bestDPColour would. */
+    int size = 0;
+    for(int c = 0; c < colourCount; c++){
+        if(column[c * k] != MAXPLUS_UNREACHABLE){
+            heap[size].score = column[c * k];
+            heap[size].colour = c;
+            heap[size].rank = 0;
+            size++;
+        }
+    }
+    makeHeap(heap, size);
+    int found = 0;
+    while(found < k && size > 0 && heap[0].score > DEFAULTSCORE){
+        struct kBestCandidate best = heap[0];
+        struct solution *s = newSolution(p);
+        s->score = best.score;
+        /* Follow the backpointers from the entry to the first term. */
+        int colour = best.colour;
+        int rank = best.rank;
+        for(int i = p->termCount - 1; i > 0; i--){
+            s->termColours[i] = colour;
+            int from = back[(size_t) (i - 1) * cells + colour * k + rank];
+            colour = from / k;
+            rank = from % k;
+        }
+        s->termColours[0] = colour;
+        solutions[found] = s;
+        found++;
+
+        if(best.rank + 1 < k && column[best.colour * k + best.rank + 1] != MAXPLUS_UNREACHABLE){
+            heap[0].score = column[best.colour * k + best.rank + 1];
+            heap[0].rank = best.rank + 1;
+        } else {
+            size--;
+            heap[0] = heap[size];
+        }
+        siftDown(heap, size, 0);
+    }
+    if(found == 0){
+        /* No colouring scores, so give the unscored one solveProblemF gives. */
+        solutions[0] = newSolution(p);
+        found = 1;
+    }
+    return found;
+}
@@ -0,0 +1,23 @@
+/*
+    Header for module which finds the k best colourings of a
+        problem as in Part F, rather than only the best.
+*/
+#include "problem.h"
+
+#ifndef KBEST_H
+#define KBEST_H
+
+/*
+    Finds up to k of the best colourings of the given problem (read for
+    Part B, E or F), best first, setting solutions[0] onwards to them.
+    Each has its colours and its score set. Colourings with equal scores
+    are ordered as the DP breaks ties, so the first is the colouring
+    solveProblemF gives, with the score solveProblemE gives. Returns how
+    many were found, fewer than k if fewer colourings have a score. If
+    none have a score, the one solution found is the unscored colouring
+    solveProblemF gives, with every term DEFAULTCOLOUR.
+    Solutions are allocated with the problem, so are freed along with it.
+*/
+int solveProblemKBest(struct problem *p, int k, struct solution **solutions);
+
+#endif
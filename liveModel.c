@@ -0,0 +1,180 @@
+/*
+    Implementation for module which holds the current version of a
+        model for a long running process.
+
+    Readers are counted in one of two counters, picked by the parity
+        of the epoch when they acquire the model. Publishing swaps in
+        the new version, then moves the epoch on, so new readers are
+        counted in the other counter and see the new version. Once the
+        counter of the old epoch drains to zero, no reader can hold
+        the old version, so it is freed. Publishes are one at a time,
+        so a counter has always drained before its parity comes round
+        again.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "liveModel.h"
+#include "modelFile.h"
+
+struct liveModel {
+    struct model *current;
+    /* Moved on once for each version published. */
+    unsigned int epoch;
+    /* Readers holding the model, by the parity of the epoch they acquired it in. */
+    int readers[2];
+    /* Held while publishing, so publishes are one at a time. */
+    pthread_mutex_t publishing;
+
+    /* The files of the reload in progress, if any. */
+    char *tablePath;
+    char *transPath;
+    char *modelPath;
+    pthread_t reloader;
+    /* 1 once a reload has been started, so there is a thread to join. */
+    int reloadStarted;
+    /* 1 while the reload thread is running. */
+    int reloading;
+};
+
+struct liveModel *newLiveModel(struct model *m){
+    struct liveModel *l = (struct liveModel *) malloc(sizeof(struct liveModel));
+    assert(l);
+    l->current = m;
+    l->epoch = 0;
+    l->readers[0] = 0;
+    l->readers[1] = 0;
+    pthread_mutex_init(&(l->publishing), NULL);
+    l->tablePath = NULL;
+    l->transPath = NULL;
+    l->modelPath = NULL;
+    l->reloadStarted = 0;
+    l->reloading = 0;
+    return l;
+}
+
+struct model *acquireLiveModel(struct liveModel *l, int *ticket){
+    while(1){
+        unsigned int epoch = __atomic_load_n(&(l->epoch), __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&(l->readers[epoch & 1]), 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&(l->epoch), __ATOMIC_SEQ_CST) == epoch){
+            /* Counted before the epoch moved on, so the version read is waited for. */
+            *ticket = (int) (epoch & 1);
+            return __atomic_load_n(&(l->current), __ATOMIC_SEQ_CST);
+        }
+        /* A publish came between, so count again under the new epoch. */
+        __atomic_fetch_sub(&(l->readers[epoch & 1]), 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void releaseLiveModel(struct liveModel *l, int ticket){
+    __atomic_fetch_sub(&(l->readers[ticket]), 1, __ATOMIC_SEQ_CST);
+}
+
+void publishLiveModel(struct liveModel *l, struct model *m){
+    pthread_mutex_lock(&(l->publishing));
+    struct model *old = __atomic_exchange_n(&(l->current), m, __ATOMIC_SEQ_CST);
+    unsigned int epoch = __atomic_fetch_add(&(l->epoch), 1, __ATOMIC_SEQ_CST);
+    /* Publishing is rare, so waiting out the readers of the old epoch can spin. */
+    while(__atomic_load_n(&(l->readers[epoch & 1]), __ATOMIC_SEQ_CST) != 0){
+        sched_yield();
+    }
+    pthread_mutex_unlock(&(l->publishing));
+    freeModel(old);
+}
+
+/* Reads the new version from the reload's files and publishes it. */
+static void *reloadModel(void *arg){
+    struct liveModel *l = (struct liveModel *) arg;
+    struct model *m = NULL;
+    if(l->modelPath){
+        FILE *modelFile = fopen(l->modelPath, "rb");
+        if(! modelFile){
+            fprintf(stderr, "File given as model file was \"%s\", which was unable to be opened\n", l->modelPath);
+            perror("Reason for file open failure");
+        } else {
+            m = mapModel(modelFile);
+            fclose(modelFile);
+            if(! m){
+                fprintf(stderr, "File given as model file was \"%s\", which is not a model file from problem2compile\n", l->modelPath);
+            }
+        }
+    } else {
+        FILE *tableFile = fopen(l->tablePath, "r");
+        FILE *transFile = l->transPath ? fopen(l->transPath, "r") : NULL;
+        if(! tableFile || (l->transPath && ! transFile)){
+            fprintf(stderr, "Table files given were \"%s\" and \"%s\", which were unable to be opened\n",
+                l->tablePath, l->transPath ? l->transPath : "");
+            perror("Reason for file open failure");
+        } else {
+            m = readModel(tableFile, transFile);
+        }
+        if(tableFile){
+            fclose(tableFile);
+        }
+        if(transFile){
+            fclose(transFile);
+        }
+    }
+    if(m){
+        publishLiveModel(l, m);
+    } else {
+        fprintf(stderr, "The tables could not be reloaded, so the tables already in use are kept\n");
+    }
+    __atomic_store_n(&(l->reloading), 0, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Copies the given path, if any. */
+static char *copyPath(const char *path){
+    if(! path){
+        return NULL;
+    }
+    char *copy = (char *) malloc(sizeof(char) * (strlen(path) + 1));
+    assert(copy);
+    strcpy(copy, path);
+    return copy;
+}
+
+int reloadLiveModel(struct liveModel *l, const char *tablePath, const char *transPath,
+    const char *modelPath){
+    if(__atomic_load_n(&(l->reloading), __ATOMIC_ACQUIRE)){
+        return 0;
+    }
+    if(l->reloadStarted){
+        pthread_join(l->reloader, NULL);
+        l->reloadStarted = 0;
+    }
+    free(l->tablePath);
+    free(l->transPath);
+    free(l->modelPath);
+    l->tablePath = copyPath(tablePath);
+    l->transPath = copyPath(transPath);
+    l->modelPath = copyPath(modelPath);
+    __atomic_store_n(&(l->reloading), 1, __ATOMIC_RELEASE);
+    if(pthread_create(&(l->reloader), NULL, reloadModel, l) != 0){
+        /* No thread to spare, so reload here instead. */
+        reloadModel(l);
+        return 1;
+    }
+    l->reloadStarted = 1;
+    return 1;
+}
+
+void freeLiveModel(struct liveModel *l){
+    if(! l){
+        return;
+    }
+    if(l->reloadStarted){
+        pthread_join(l->reloader, NULL);
+    }
+    pthread_mutex_destroy(&(l->publishing));
+    freeModel(l->current);
+    free(l->tablePath);
+    free(l->transPath);
+    free(l->modelPath);
+    free(l);
+}
@@ -0,0 +1,51 @@
+/*
+    Header for module which holds the current version of a model
+        for a long running process, letting a new version of the
+        tables be loaded and swapped in while texts are being
+        solved against the old one.
+*/
+#include "problem.h"
+
+#ifndef LIVEMODEL_H
+#define LIVEMODEL_H
+
+struct liveModel;
+
+/* Sets up a live model whose first version is the given model. */
+struct liveModel *newLiveModel(struct model *m);
+
+/*
+    Returns the current version of the model, which stays valid until
+    releaseLiveModel is called with the ticket set here, even if a new
+    version is published meanwhile. Takes no locks, so can be called
+    from any number of threads, typically once for each text solved.
+*/
+struct model *acquireLiveModel(struct liveModel *l, int *ticket);
+
+/* Releases the version of the model acquired with the given ticket. */
+void releaseLiveModel(struct liveModel *l, int ticket);
+
+/*
+    Makes the given model the current version, then waits for every
+    solve which acquired an earlier version to release it and frees it.
+    Texts acquiring the model from this point on get the new version.
+*/
+void publishLiveModel(struct liveModel *l, struct model *m);
+
+/*
+    Starts reading a new version of the model on a thread of its own,
+    from a model file written by problem2compile if modelPath is not
+    NULL, otherwise from the given table and transition table (NULL for
+    Part A), publishing it once read. The current version stays in use
+    if a file can't be opened, a table has a malformed row, or the
+    model file isn't one or is cut short. Returns 0 if the
+    last reload hasn't finished, so none was started. Only one thread
+    should start reloads.
+*/
+int reloadLiveModel(struct liveModel *l, const char *tablePath, const char *transPath,
+    const char *modelPath);
+
+/* Waits for any reload to finish, then frees the live model and its current version. */
+void freeLiveModel(struct liveModel *l);
+
+#endif
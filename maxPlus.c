@@ -0,0 +1,252 @@
+/*
+    Implementation for module which provides the max-plus kernel
+        used for each step of the Viterbi DP.
+
+    The vector kernels put consecutive colours of the next column in
+        int32 lanes and sweep the previous column, so each row of the
+        transition matrix is one contiguous load per lane group. The
+        scalar kernel is kept for CPUs without SSE4.1 and for the 
+        colours left over after the last full lane group.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include "maxPlus.h"
+
+typedef void (*maxPlusKernel)(const int *prev, const int *matrix, 
+    const int *wc, int *next, int colourCount);
+
+typedef void (*maxPlusArgmaxKernel)(const int *prev, const int *matrix, 
+    const int *wc, int *next, int *from, int colourCount);
+
+/* 
+    Computes colours [from, colourCount) of the step one at a time. 
+    Always inlined so a constant colourCount gives unrolled loops.
+*/
+static inline __attribute__((always_inline)) void maxPlusScalar(const int *prev, 
+    const int *matrix, const int *wc, int *next, int from, int colourCount){
+    for(int c = from; c < colourCount; c++){
+        int best = MAXPLUS_UNREACHABLE;
+        for(int j = 0; j < colourCount; j++){
+            int candidate = prev[j] + matrix[j * colourCount + c];
+            best = candidate > best ? candidate : best;
+        }
+        int score = best + wc[c];
+        next[c] = (wc[c] != MAXPLUS_NO_SCORE && score > MAXPLUS_NO_SCORE) ? score : MAXPLUS_UNREACHABLE;
+    }
+}
+
+static void maxPlusStepScalar(const int *prev, const int *matrix, 
+    const int *wc, int *next, int colourCount){
+    /* Fixed colour counts for common palettes. */
+    switch(colourCount){
+        case 4:
+            maxPlusScalar(prev, matrix, wc, next, 0, 4);
+            break;
+        case 8:
+            maxPlusScalar(prev, matrix, wc, next, 0, 8);
+            break;
+        case 16:
+            maxPlusScalar(prev, matrix, wc, next, 0, 16);
+            break;
+        default:
+            maxPlusScalar(prev, matrix, wc, next, 0, colourCount);
+            break;
+    }
+}
+
+/* As maxPlusScalar, also keeping the first j giving the maximum. */
+static inline __attribute__((always_inline)) void maxPlusArgmaxScalar(const int *prev, 
+    const int *matrix, const int *wc, int *next, int *from, int first, int colourCount){
+    for(int c = first; c < colourCount; c++){
+        int best = MAXPLUS_UNREACHABLE;
+        int bestFrom = 0;
+        for(int j = 0; j < colourCount; j++){
+            int candidate = prev[j] + matrix[j * colourCount + c];
+            if(candidate > best){
+                best = candidate;
+                bestFrom = j;
+            }
+        }
+        int score = best + wc[c];
+        next[c] = (wc[c] != MAXPLUS_NO_SCORE && score > MAXPLUS_NO_SCORE) ? score : MAXPLUS_UNREACHABLE;
+        from[c] = bestFrom;
+    }
+}
+
+static void maxPlusStepArgmaxScalar(const int *prev, const int *matrix, 
+    const int *wc, int *next, int *from, int colourCount){
+    switch(colourCount){
+        case 4:
+            maxPlusArgmaxScalar(prev, matrix, wc, next, from, 0, 4);
+            break;
+        case 8:
+            maxPlusArgmaxScalar(prev, matrix, wc, next, from, 0, 8);
+            break;
+        case 16:
+            maxPlusArgmaxScalar(prev, matrix, wc, next, from, 0, 16);
+            break;
+        default:
+            maxPlusArgmaxScalar(prev, matrix, wc, next, from, 0, colourCount);
+            break;
+    }
+}
+
+/* Computes colours [from, from + 4) of the step in SSE lanes. */
+__attribute__((target("sse4.1")))
+static inline void maxPlusSSE4Lanes(const int *prev, const int *matrix, 
+    const int *wc, int *next, int from, int colourCount){
+    const __m128i unreachable = _mm_set1_epi32(MAXPLUS_UNREACHABLE);
+    const __m128i noScore = _mm_set1_epi32(MAXPLUS_NO_SCORE);
+    __m128i best = unreachable;
+    for(int j = 0; j < colourCount; j++){
+        __m128i row = _mm_loadu_si128((const __m128i *) (matrix + j * colourCount + from));
+        best = _mm_max_epi32(best, _mm_add_epi32(_mm_set1_epi32(prev[j]), row));
+    }
+    __m128i w = _mm_loadu_si128((const __m128i *) (wc + from));
+    __m128i score = _mm_add_epi32(best, w);
+    __m128i reachable = _mm_andnot_si128(_mm_cmpeq_epi32(w, noScore), _mm_cmpgt_epi32(score, noScore));
+    _mm_storeu_si128((__m128i *) (next + from), _mm_blendv_epi8(unreachable, score, reachable));
+}
+
+__attribute__((target("sse4.1")))
+static void maxPlusStepSSE41(const int *prev, const int *matrix, 
+    const int *wc, int *next, int colourCount){
+    int c = 0;
+    for(; c + 4 <= colourCount; c += 4){
+        maxPlusSSE4Lanes(prev, matrix, wc, next, c, colourCount);
+    }
+    maxPlusScalar(prev, matrix, wc, next, c, colourCount);
+}
+
+/* As maxPlusSSE4Lanes, also keeping the first j giving the maximum. */
+__attribute__((target("sse4.1")))
+static inline void maxPlusArgmaxSSE4Lanes(const int *prev, const int *matrix, 
+    const int *wc, int *next, int *from, int first, int colourCount){
+    const __m128i unreachable = _mm_set1_epi32(MAXPLUS_UNREACHABLE);
+    const __m128i noScore = _mm_set1_epi32(MAXPLUS_NO_SCORE);
+    __m128i best = unreachable;
+    __m128i bestFrom = _mm_setzero_si128();
+    for(int j = 0; j < colourCount; j++){
+        __m128i row = _mm_loadu_si128((const __m128i *) (matrix + j * colourCount + first));
+        __m128i candidate = _mm_add_epi32(_mm_set1_epi32(prev[j]), row);
+        /* Strictly greater, so ties keep the earlier j. */
+        __m128i better = _mm_cmpgt_epi32(candidate, best);
+        best = _mm_max_epi32(best, candidate);
+        bestFrom = _mm_blendv_epi8(bestFrom, _mm_set1_epi32(j), better);
+    }
+    __m128i w = _mm_loadu_si128((const __m128i *) (wc + first));
+    __m128i score = _mm_add_epi32(best, w);
+    __m128i reachable = _mm_andnot_si128(_mm_cmpeq_epi32(w, noScore), _mm_cmpgt_epi32(score, noScore));
+    _mm_storeu_si128((__m128i *) (next + first), _mm_blendv_epi8(unreachable, score, reachable));
+    _mm_storeu_si128((__m128i *) (from + first), bestFrom);
+}
+
+__attribute__((target("sse4.1")))
+static void maxPlusStepArgmaxSSE41(const int *prev, const int *matrix, 
+    const int *wc, int *next, int *from, int colourCount){
+    int c = 0;
+    for(; c + 4 <= colourCount; c += 4){
+        maxPlusArgmaxSSE4Lanes(prev, matrix, wc, next, from, c, colourCount);
+    }
+    maxPlusArgmaxScalar(prev, matrix, wc, next, from, c, colourCount);
+}
+
+__attribute__((target("avx2")))
+static void maxPlusStepAVX2(const int *prev, const int *matrix, 
+    const int *wc, int *next, int colourCount){
+    const __m256i unreachable = _mm256_set1_epi32(MAXPLUS_UNREACHABLE);
+    const __m256i noScore = _mm256_set1_epi32(MAXPLUS_NO_SCORE);
+    int c = 0;
+    for(; c + 8 <= colourCount; c += 8){
+        __m256i best = unreachable;
+        for(int j = 0; j < colourCount; j++){
+            __m256i row = _mm256_loadu_si256((const __m256i *) (matrix + j * colourCount + c));
+            best = _mm256_max_epi32(best, _mm256_add_epi32(_mm256_set1_epi32(prev[j]), row));
+        }
+        __m256i w = _mm256_loadu_si256((const __m256i *) (wc + c));
+        __m256i score = _mm256_add_epi32(best, w);
+        __m256i reachable = _mm256_andnot_si256(_mm256_cmpeq_epi32(w, noScore), _mm256_cmpgt_epi32(score, noScore));
+        _mm256_storeu_si256((__m256i *) (next + c), _mm256_blendv_epi8(unreachable, score, reachable));
+    }
+    for(; c + 4 <= colourCount; c += 4){
+        maxPlusSSE4Lanes(prev, matrix, wc, next, c, colourCount);
+    }
+    maxPlusScalar(prev, matrix, wc, next, c, colourCount);
+}
+
+__attribute__((target("avx2")))
+static void maxPlusStepArgmaxAVX2(const int *prev, const int *matrix, 
+    const int *wc, int *next, int *from, int colourCount){
+    const __m256i unreachable = _mm256_set1_epi32(MAXPLUS_UNREACHABLE);
+    const __m256i noScore = _mm256_set1_epi32(MAXPLUS_NO_SCORE);
+    int c = 0;
+    for(; c + 8 <= colourCount; c += 8){
+        __m256i best = unreachable;
+        __m256i bestFrom = _mm256_setzero_si256();
+        for(int j = 0; j < colourCount; j++){
+            __m256i row = _mm256_loadu_si256((const __m256i *) (matrix + j * colourCount + c));
+            __m256i candidate = _mm256_add_epi32(_mm256_set1_epi32(prev[j]), row);
+            /* Strictly greater, so ties keep the earlier j. */
+            __m256i better = _mm256_cmpgt_epi32(candidate, best);
+            best = _mm256_max_epi32(best, candidate);
+            bestFrom = _mm256_blendv_epi8(bestFrom, _mm256_set1_epi32(j), better);
+        }
+        __m256i w = _mm256_loadu_si256((const __m256i *) (wc + c));
+        __m256i score = _mm256_add_epi32(best, w);
+        __m256i reachable = _mm256_andnot_si256(_mm256_cmpeq_epi32(w, noScore), _mm256_cmpgt_epi32(score, noScore));
+        _mm256_storeu_si256((__m256i *) (next + c), _mm256_blendv_epi8(unreachable, score, reachable));
+        _mm256_storeu_si256((__m256i *) (from + c), bestFrom);
+    }
+    for(; c + 4 <= colourCount; c += 4){
+        maxPlusArgmaxSSE4Lanes(prev, matrix, wc, next, from, c, colourCount);
+    }
+    maxPlusArgmaxScalar(prev, matrix, wc, next, from, c, colourCount);
+}
+
+/* 
+    Kernel chosen for this CPU, set before main runs. Setting MAXPLUS_KERNEL
+    in the environment to one of the names below picks a slower kernel,
+    for comparing them.
+*/
+static maxPlusKernel kernel = maxPlusStepScalar;
+static maxPlusArgmaxKernel argmaxKernel = maxPlusStepArgmaxScalar;
+static const char *kernelName = "scalar";
+
+__attribute__((constructor))
+static void chooseKernel(){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        kernel = maxPlusStepAVX2;
+        argmaxKernel = maxPlusStepArgmaxAVX2;
+        kernelName = "avx2";
+    } else if(__builtin_cpu_supports("sse4.1")){
+        kernel = maxPlusStepSSE41;
+        argmaxKernel = maxPlusStepArgmaxSSE41;
+        kernelName = "sse4.1";
+    }
+    const char *forced = getenv("MAXPLUS_KERNEL");
+    if(forced && strcmp(forced, "scalar") == 0){
+        kernel = maxPlusStepScalar;
+        argmaxKernel = maxPlusStepArgmaxScalar;
+        kernelName = "scalar";
+    } else if(forced && strcmp(forced, "sse4.1") == 0 && __builtin_cpu_supports("sse4.1")){
+        kernel = maxPlusStepSSE41;
+        argmaxKernel = maxPlusStepArgmaxSSE41;
+        kernelName = "sse4.1";
+    }
+}
+
+void maxPlusStep(const int *prev, const int *matrix, const int *wc, int *next,
+    int colourCount){
+    kernel(prev, matrix, wc, next, colourCount);
+}
+
+void maxPlusStepArgmax(const int *prev, const int *matrix, const int *wc, 
+    int *next, int *from, int colourCount){
+    argmaxKernel(prev, matrix, wc, next, from, colourCount);
+}
+
+const char *maxPlusKernelName(){
+    return kernelName;
+}
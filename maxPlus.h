@@ -0,0 +1,39 @@
+/*
+    Header for module which provides the max-plus kernel used
+        for each step of the Viterbi DP, with SSE4.1 and AVX2
+        versions chosen at runtime by what the CPU supports.
+*/
+#include <limits.h>
+
+/*
+    Score marking a colour which can't be reached. Low enough that adding
+    a term and transition score to it stays far below any real score
+    without overflowing.
+*/
+#define MAXPLUS_UNREACHABLE (INT_MIN / 4)
+
+/* Term colour scores equal to this have no score, as DEFAULTSCORE. */
+#define MAXPLUS_NO_SCORE (-1)
+
+/*
+    Computes one DP step over colourCount colours:
+
+        next[c] = wc[c] + max_j(prev[j] + matrix[j * colourCount + c])
+
+    where next[c] is MAXPLUS_UNREACHABLE if wc[c] is MAXPLUS_NO_SCORE or
+    the result doesn't beat MAXPLUS_NO_SCORE. Unreachable colours in prev
+    are MAXPLUS_UNREACHABLE.
+*/
+void maxPlusStep(const int *prev, const int *matrix, const int *wc, int *next,
+    int colourCount);
+
+/*
+    Same as maxPlusStep, but also sets from[c] to the first j giving the
+    maximum for colour c, the colour of the previous term on the best 
+    path. from[c] is meaningless where next[c] is unreachable.
+*/
+void maxPlusStepArgmax(const int *prev, const int *matrix, const int *wc, 
+    int *next, int *from, int colourCount);
+
+/* Returns the name of the kernel maxPlusStep uses on this CPU. */
+const char *maxPlusKernelName();
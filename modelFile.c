@@ -0,0 +1,417 @@
+/*
+    Implementation for module which writes models to precompiled
+        model files and maps them back in.
+
+    A model file is a header followed by sections, each starting on
+        a cache line. The terms are stored once as nul-terminated
+        strings, the colours and scores of every term colour table as
+        one dense array each, and the trie, transition table and its
+        matrix exactly as they are held in memory, so mapping a model
+        only allocates the structs pointing into the file and the
+        slots of the term index. Files are only read on machines with
+        the same byte order and int size as the one that wrote them.
+
+    The file also records which table and transition table the model
+        was read from, with their size and time of last change when it
+        was written, so a cached model can be checked against them.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "problemInternal.h"
+#include "termHash.h"
+#include "termTrie.h"
+#include "problemStruct.c"
+#include "modelFile.h"
+#include "tableParse.h"
+
+/* Identifies model files, followed by the version. */
+#define MODELFILE_MAGIC "CSNMODEL"
+#define MODELFILE_MAGIC_LENGTH 8
+/* Changed whenever the layout of the file changes. */
+#define MODELFILE_VERSION 2
+/* Read back in another byte order as a different value. */
+#define MODELFILE_BYTE_ORDER 0x01020304u
+
+/* Alignment of each section, one cache line. */
+#define SECTIONALIGNMENT 64
+
+/* The files a model is read from, the table then the transition table. */
+#define SOURCECOUNT 2
+
+enum modelFileSection {
+    /* Offset of each term into the strings section. */
+    SECTION_TERMS = 0,
+    SECTION_STRINGS,
+    /* The colours and scores of table i start at i * colourCount. */
+    SECTION_COLOURS,
+    SECTION_SCORES,
+    SECTION_NOSCORES,
+    SECTION_HASH,
+    SECTION_TRIE,
+    /* Transition table, if the model has one. */
+    SECTION_PREVCOLOURS,
+    SECTION_TRANSCOLOURS,
+    SECTION_TRANSSCORES,
+    SECTION_MATRIX,
+    SECTION_ALLOWED,
+    /* A modelFileSource for each source, then the path of each with a nul after it. */
+    SECTION_SOURCES,
+    SECTIONCOUNT
+};
+
+struct modelFileHeader {
+    char magic[MODELFILE_MAGIC_LENGTH];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t intSize;
+    int32_t termColourTableCount;
+    int32_t colourCount;
+    int32_t maxTermLength;
+    /* Whether the transition table sections are present. */
+    int32_t hasTransitions;
+    int32_t transitionCount;
+    int32_t matrixColours;
+    int32_t allowedWords;
+    /* Offset of each section from the start of the file. */
+    uint64_t sections[SECTIONCOUNT];
+};
+
+/* How a file a model was read from was when the model was written. */
+struct modelFileSource {
+    /* Length of the path, or -1 if there was no such file. */
+    int64_t pathLength;
+    int64_t size;
+    int64_t modifiedSeconds;
+    int64_t modifiedNanoseconds;
+};
+
+/*
+    Fills in the given source for the file at path, which is made
+    absolute in resolved so the same file is found however it is named.
+    Returns 0 if there is no path or the file can't be found.
+*/
+static int findSource(const char *path, struct modelFileSource *source, char *resolved){
+    struct stat status;
+    memset(source, 0, sizeof(struct modelFileSource));
+    source->pathLength = -1;
+    resolved[0] = '\0';
+    if(! path || ! realpath(path, resolved) || stat(resolved, &status) != 0){
+        return 0;
+    }
+    source->pathLength = (int64_t) strlen(resolved);
+    source->size = (int64_t) status.st_size;
+    source->modifiedSeconds = (int64_t) status.st_mtim.tv_sec;
+    source->modifiedNanoseconds = (int64_t) status.st_mtim.tv_nsec;
+    return 1;
+}
+
+/* Pads the file with zeros to the next section boundary, returning the offset. */
+static uint64_t startSection(FILE *modelFile){
+    long offset = ftell(modelFile);
+    assert(offset >= 0);
+    while(offset % SECTIONALIGNMENT != 0){
+        fputc('\0', modelFile);
+        offset++;
+    }
+    return (uint64_t) offset;
+}
+
+/* Writes the model with the given paths recorded as where it was read from. */
+static void writeModelSources(struct model *m, FILE *modelFile, const char *tablePath,
+    const char *transPath){
+    struct modelFileHeader header;
+    memset(&header, 0, sizeof(struct modelFileHeader));
+    memcpy(header.magic, MODELFILE_MAGIC, MODELFILE_MAGIC_LENGTH);
+    header.version = MODELFILE_VERSION;
+    header.byteOrder = MODELFILE_BYTE_ORDER;
+    header.intSize = sizeof(int);
+    header.termColourTableCount = m->termColourTableCount;
+    header.colourCount = m->colourCount;
+    header.maxTermLength = m->maxTermLength;
+    header.hasTransitions = (m->colourTransitionTable != NULL);
+    /* Filled in once the sections are written. */
+    fwrite(&header, sizeof(struct modelFileHeader), 1, modelFile);
+
+    header.sections[SECTION_TERMS] = startSection(modelFile);
+    uint64_t termOffset = 0;
+    for(int i = 0; i < m->termColourTableCount; i++){
+        fwrite(&termOffset, sizeof(uint64_t), 1, modelFile);
+        termOffset += strlen(m->colourTables[i].term) + 1;
+    }
+    header.sections[SECTION_STRINGS] = startSection(modelFile);
+    for(int i = 0; i < m->termColourTableCount; i++){
+        fwrite(m->colourTables[i].term, sizeof(char), strlen(m->colourTables[i].term) + 1, modelFile);
+    }
+    /* Every table has a colour and score for each colour of the model. */
+    header.sections[SECTION_COLOURS] = startSection(modelFile);
+    for(int i = 0; i < m->termColourTableCount; i++){
+        assert(m->colourTables[i].colourCount == m->colourCount);
+        fwrite(m->colourTables[i].colours, sizeof(int), m->colourCount, modelFile);
+    }
+    header.sections[SECTION_SCORES] = startSection(modelFile);
+    for(int i = 0; i < m->termColourTableCount; i++){
+        fwrite(m->colourTables[i].scores, sizeof(int), m->colourCount, modelFile);
+    }
+    header.sections[SECTION_NOSCORES] = startSection(modelFile);
+    fwrite(m->noScores, sizeof(int), m->colourCount, modelFile);
+    header.sections[SECTION_HASH] = startSection(modelFile);
+    writeTermHash(m->termIndex, modelFile);
+    header.sections[SECTION_TRIE] = startSection(modelFile);
+    writeTermTrie(m->termTrie, modelFile);
+
+    if(m->colourTransitionTable){
+        struct colourTransitionTable *t = m->colourTransitionTable;
+        header.transitionCount = t->transitionCount;
+        header.matrixColours = t->matrixColours;
+        header.allowedWords = t->allowedWords;
+        header.sections[SECTION_PREVCOLOURS] = startSection(modelFile);
+        fwrite(t->prevColours, sizeof(int), t->transitionCount, modelFile);
+        header.sections[SECTION_TRANSCOLOURS] = startSection(modelFile);
+        fwrite(t->colours, sizeof(int), t->transitionCount, modelFile);
+        header.sections[SECTION_TRANSSCORES] = startSection(modelFile);
+        fwrite(t->scores, sizeof(int), t->transitionCount, modelFile);
+        header.sections[SECTION_MATRIX] = startSection(modelFile);
+        fwrite(t->matrix, sizeof(int), t->matrixColours * t->matrixColours, modelFile);
+        header.sections[SECTION_ALLOWED] = startSection(modelFile);
+        fwrite(t->allowed, sizeof(uint64_t), t->matrixColours * t->allowedWords, modelFile);
+    }
+
+    const char *paths[SOURCECOUNT] = { tablePath, transPath };
+    struct modelFileSource sources[SOURCECOUNT];
+    char resolved[SOURCECOUNT][PATH_MAX];
+    for(int i = 0; i < SOURCECOUNT; i++){
+        findSource(paths[i], &sources[i], resolved[i]);
+    }
+    header.sections[SECTION_SOURCES] = startSection(modelFile);
+    fwrite(sources, sizeof(struct modelFileSource), SOURCECOUNT, modelFile);
+    for(int i = 0; i < SOURCECOUNT; i++){
+        fwrite(resolved[i], sizeof(char), strlen(resolved[i]) + 1, modelFile);
+    }
+
+    fseek(modelFile, 0, SEEK_SET);
+    fwrite(&header, sizeof(struct modelFileHeader), 1, modelFile);
+    fseek(modelFile, 0, SEEK_END);
+}
+
+/*
+    Returns 1 if the given section starts aligned and has room for
+    count items of itemSize bytes before the end of the file.
+*/
+static int sectionFits(const struct modelFileHeader *header, int section, uint64_t count,
+    uint64_t itemSize, size_t size){
+    uint64_t start = header->sections[section];
+    return start % sizeof(uint64_t) == 0 && start <= size && count <= (size - start) / itemSize;
+}
+
+/*
+    Returns 1 if every count in the header is one a model could have,
+    and each section holds that many items within the file.
+*/
+static int headerFits(const struct modelFileHeader *header, const char *data, size_t size){
+    if(header->termColourTableCount < 0 || header->colourCount < 0 ||
+        header->colourCount > MAXCOLOURS || header->maxTermLength < 0){
+        return 0;
+    }
+    uint64_t tables = (uint64_t) header->termColourTableCount;
+    uint64_t colours = (uint64_t) header->colourCount;
+    if(! sectionFits(header, SECTION_TERMS, tables, sizeof(uint64_t), size) ||
+        ! sectionFits(header, SECTION_COLOURS, tables * colours, sizeof(int), size) ||
+        ! sectionFits(header, SECTION_SCORES, tables * colours, sizeof(int), size) ||
+        ! sectionFits(header, SECTION_NOSCORES, colours, sizeof(int), size) ||
+        ! sectionFits(header, SECTION_HASH, 0, 1, size) ||
+        ! sectionFits(header, SECTION_TRIE, 0, 1, size)){
+        return 0;
+    }
+    /* Each path must run to a nul at its recorded length, within the file. */
+    if(! sectionFits(header, SECTION_SOURCES, SOURCECOUNT, sizeof(struct modelFileSource), size)){
+        return 0;
+    }
+    const struct modelFileSource *sources = (const struct modelFileSource *) (data + header->sections[SECTION_SOURCES]);
+    uint64_t pathsLength = 0;
+    for(int i = 0; i < SOURCECOUNT; i++){
+        if(sources[i].pathLength < -1 || sources[i].pathLength > PATH_MAX){
+            return 0;
+        }
+        pathsLength += (uint64_t) (sources[i].pathLength + 1) + (sources[i].pathLength < 0);
+    }
+    if(! sectionFits(header, SECTION_SOURCES, SOURCECOUNT * sizeof(struct modelFileSource) + pathsLength, 1, size)){
+        return 0;
+    }
+    const char *path = (const char *) (sources + SOURCECOUNT);
+    for(int i = 0; i < SOURCECOUNT; i++){
+        int64_t length = sources[i].pathLength < 0 ? 0 : sources[i].pathLength;
+        if(memchr(path, '\0', (size_t) length + 1) != path + length){
+            return 0;
+        }
+        path += length + 1;
+    }
+    /* The strings run up to the colours, ending with a nul so no term runs past them. */
+    uint64_t stringsStart = header->sections[SECTION_STRINGS];
+    uint64_t stringsEnd = header->sections[SECTION_COLOURS];
+    if(stringsStart >= stringsEnd || data[stringsEnd - 1] != '\0'){
+        return 0;
+    }
+    const uint64_t *termOffsets = (const uint64_t *) (data + header->sections[SECTION_TERMS]);
+    for(uint64_t i = 0; i < tables; i++){
+        if(termOffsets[i] >= stringsEnd - stringsStart){
+            return 0;
+        }
+    }
+
+    if(header->hasTransitions){
+        /* The matrix is indexed by the colours of the model. */
+        if(header->transitionCount < 0 || header->matrixColours != header->colourCount ||
+            header->allowedWords < (header->colourCount + 63) / 64){
+            return 0;
+        }
+        uint64_t transitions = (uint64_t) header->transitionCount;
+        uint64_t matrixColours = (uint64_t) header->matrixColours;
+        if(! sectionFits(header, SECTION_PREVCOLOURS, transitions, sizeof(int), size) ||
+            ! sectionFits(header, SECTION_TRANSCOLOURS, transitions, sizeof(int), size) ||
+            ! sectionFits(header, SECTION_TRANSSCORES, transitions, sizeof(int), size) ||
+            ! sectionFits(header, SECTION_MATRIX, matrixColours * matrixColours, sizeof(int), size) ||
+            ! sectionFits(header, SECTION_ALLOWED, matrixColours * (uint64_t) header->allowedWords,
+                sizeof(uint64_t), size)){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void writeModel(struct model *m, FILE *modelFile){
+    writeModelSources(m, modelFile, NULL, NULL);
+}
+
+int writeModelFile(struct model *m, const char *path, const char *tablePath,
+    const char *transPath){
+    /* Written beside the file then renamed over it, so a reader never maps half a model. */
+    char *writingPath = (char *) malloc(sizeof(char) * (strlen(path) + 32));
+    assert(writingPath);
+    sprintf(writingPath, "%s.%ld", path, (long) getpid());
+    FILE *modelFile = fopen(writingPath, "wb");
+    if(! modelFile){
+        fprintf(stderr, "File given as model file was \"%s\", which was unable to be written\n", path);
+        perror("Reason for file open failure");
+        free(writingPath);
+        return 0;
+    }
+    writeModelSources(m, modelFile, tablePath, transPath);
+    int written = (fclose(modelFile) == 0);
+    if(! written || rename(writingPath, path) != 0){
+        fprintf(stderr, "File given as model file was \"%s\", which was unable to be written\n", path);
+        perror("Reason for write failure");
+        unlink(writingPath);
+        free(writingPath);
+        return 0;
+    }
+    free(writingPath);
+    return 1;
+}
+
+int modelReadFrom(struct model *m, const char *tablePath, const char *transPath){
+    if(! m->mapping){
+        return 0;
+    }
+    const struct modelFileHeader *header = (const struct modelFileHeader *) m->mapping;
+    const struct modelFileSource *recorded = (const struct modelFileSource *) ((char *) m->mapping +
+        header->sections[SECTION_SOURCES]);
+    const char *recordedPath = (const char *) (recorded + SOURCECOUNT);
+    const char *paths[SOURCECOUNT] = { tablePath, transPath };
+    for(int i = 0; i < SOURCECOUNT; i++){
+        struct modelFileSource source;
+        char resolved[PATH_MAX];
+        findSource(paths[i], &source, resolved);
+        if(source.pathLength != recorded[i].pathLength || source.size != recorded[i].size ||
+            source.modifiedSeconds != recorded[i].modifiedSeconds ||
+            source.modifiedNanoseconds != recorded[i].modifiedNanoseconds ||
+            strcmp(resolved, recordedPath) != 0){
+            return 0;
+        }
+        recordedPath += strlen(recordedPath) + 1;
+    }
+    return 1;
+}
+
+struct model *mapModel(FILE *modelFile){
+    struct stat status;
+    if(fstat(fileno(modelFile), &status) != 0 || status.st_size < (off_t) sizeof(struct modelFileHeader)){
+        return NULL;
+    }
+    size_t size = (size_t) status.st_size;
+    char *data = (char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(modelFile), 0);
+    if(data == MAP_FAILED){
+        return NULL;
+    }
+
+    const struct modelFileHeader *header = (const struct modelFileHeader *) data;
+    int valid = memcmp(header->magic, MODELFILE_MAGIC, MODELFILE_MAGIC_LENGTH) == 0 &&
+        header->version == MODELFILE_VERSION &&
+        header->byteOrder == MODELFILE_BYTE_ORDER &&
+        header->intSize == sizeof(int);
+    if(! valid || ! headerFits(header, data, size)){
+        munmap(data, size);
+        return NULL;
+    }
+
+    struct model *m = newModel();
+    m->mapping = data;
+    m->mappingSize = size;
+    m->termColourTableCount = header->termColourTableCount;
+    m->colourCount = header->colourCount;
+    m->maxTermLength = header->maxTermLength;
+    m->noScores = (int *) (data + header->sections[SECTION_NOSCORES]);
+
+    const uint64_t *termOffsets = (const uint64_t *) (data + header->sections[SECTION_TERMS]);
+    char *strings = data + header->sections[SECTION_STRINGS];
+    int *colours = (int *) (data + header->sections[SECTION_COLOURS]);
+    int *scores = (int *) (data + header->sections[SECTION_SCORES]);
+    const char **terms = NULL;
+    if(m->termColourTableCount > 0){
+        m->colourTables = (struct termColourTable *) malloc(sizeof(struct termColourTable) * m->termColourTableCount);
+        assert(m->colourTables);
+        terms = (const char **) malloc(sizeof(const char *) * m->termColourTableCount);
+        assert(terms);
+    }
+    for(int i = 0; i < m->termColourTableCount; i++){
+        struct termColourTable *t = &(m->colourTables[i]);
+        t->term = strings + termOffsets[i];
+        t->colourCount = m->colourCount;
+        t->colours = colours + (size_t) i * m->colourCount;
+        t->scores = scores + (size_t) i * m->colourCount;
+        terms[i] = t->term;
+    }
+    m->termIndex = mapTermHash(data + header->sections[SECTION_HASH],
+        size - header->sections[SECTION_HASH], terms, m->termColourTableCount);
+    m->termTrie = mapTermTrie(data + header->sections[SECTION_TRIE],
+        size - header->sections[SECTION_TRIE], m->termColourTableCount);
+    /* The index keeps the terms themselves, not the array of them. */
+    free(terms);
+    if(! m->termIndex || ! m->termTrie){
+        /* Frees the mapping along with the model. */
+        freeModel(m);
+        return NULL;
+    }
+
+    if(header->hasTransitions){
+        struct colourTransitionTable *t = (struct colourTransitionTable *) malloc(sizeof(struct colourTransitionTable));
+        assert(t);
+        t->transitionCount = header->transitionCount;
+        t->prevColours = (int *) (data + header->sections[SECTION_PREVCOLOURS]);
+        t->colours = (int *) (data + header->sections[SECTION_TRANSCOLOURS]);
+        t->scores = (int *) (data + header->sections[SECTION_TRANSSCORES]);
+        t->matrixColours = header->matrixColours;
+        t->matrix = (int *) (data + header->sections[SECTION_MATRIX]);
+        t->allowedWords = header->allowedWords;
+        t->allowed = (uint64_t *) (data + header->sections[SECTION_ALLOWED]);
+        m->colourTransitionTable = t;
+    }
+
+    return m;
+}
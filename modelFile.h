@@ -0,0 +1,43 @@
+/*
+    Header for module which writes a model to a precompiled
+        model file, and maps model files back into models
+        without parsing the tables again.
+*/
+#include <stdio.h>
+
+struct model;
+
+/*
+    Writes the given model, including its term index, trie and
+    transition matrix, to the given file in the form read by
+    mapModel.
+*/
+void writeModel(struct model *m, FILE *modelFile);
+
+/*
+    Writes the given model to the model file at path, recording that
+    it was read from the given table and transition table (NULL if
+    there was none). The model is written to a new file beside it
+    which is then renamed over it, so processes which have the old
+    file mapped keep using it and no reader sees half a model.
+    Returns 0 after reporting why if the file can't be written.
+*/
+int writeModelFile(struct model *m, const char *path, const char *tablePath,
+    const char *transPath);
+
+/*
+    Maps a model file written by writeModel into a model, using its
+    tables in place. Returns NULL if the file isn't a model file of
+    the version read here, or is cut short or corrupt so its sections
+    don't fit in it. The file can be closed once mapped, the
+    mapping is released by freeModel.
+*/
+struct model *mapModel(FILE *modelFile);
+
+/*
+    Returns 1 if the given model was mapped from a model file written
+    from the given table and transition table (NULL if none), each
+    the same size and last changed at the same time as when it was
+    written, so it can stand in for reading them.
+*/
+int modelReadFrom(struct model *m, const char *tablePath, const char *transPath);
@@ -0,0 +1,74 @@
+/*
+    Implementation for module which formats output into a large
+        buffer.
+
+    Each flush is a single fwrite of the whole buffer. That is well
+        past stdio's own buffer, so for files and pipes it goes
+        straight to one write call, while still keeping its place
+        among anything else written to the same file.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "outputBuffer.h"
+
+/* Most characters an int takes in decimal, including its sign. */
+#define MAXINTCHARS 11
+
+void newOutputBuffer(struct outputBuffer *ob, FILE *out){
+    ob->out = out;
+    ob->length = 0;
+}
+
+void outputBufferFlush(struct outputBuffer *ob){
+    if(ob->length > 0){
+        fwrite(ob->data, sizeof(char), ob->length, ob->out);
+        ob->length = 0;
+    }
+}
+
+void outputBufferWrite(struct outputBuffer *ob, const char *text, size_t length){
+    if(ob->length + length > OUTPUTBUFFERSIZE){
+        outputBufferFlush(ob);
+        if(length > OUTPUTBUFFERSIZE){
+            /* Too long to hold, so write it directly. */
+            fwrite(text, sizeof(char), length, ob->out);
+            return;
+        }
+    }
+    memcpy(ob->data + ob->length, text, length);
+    ob->length += length;
+}
+
+void outputBufferString(struct outputBuffer *ob, const char *text){
+    outputBufferWrite(ob, text, strlen(text));
+}
+
+void outputBufferChar(struct outputBuffer *ob, char c){
+    if(ob->length == OUTPUTBUFFERSIZE){
+        outputBufferFlush(ob);
+    }
+    ob->data[ob->length] = c;
+    ob->length++;
+}
+
+void outputBufferInt(struct outputBuffer *ob, int value){
+    if(ob->length + MAXINTCHARS > OUTPUTBUFFERSIZE){
+        outputBufferFlush(ob);
+    }
+    /* Digits are found last first, so are written from the end of digits. */
+    char digits[MAXINTCHARS];
+    int start = MAXINTCHARS;
+    /* Unsigned so INT_MIN can be negated. */
+    unsigned int magnitude = (value < 0) ? 0u - (unsigned int) value : (unsigned int) value;
+    do {
+        start--;
+        digits[start] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude > 0);
+    if(value < 0){
+        start--;
+        digits[start] = '-';
+    }
+    memcpy(ob->data + ob->length, digits + start, MAXINTCHARS - start);
+    ob->length += MAXINTCHARS - start;
+}
@@ -0,0 +1,43 @@
+/*
+    Header for module which formats output into a large buffer,
+        writing it to its file a buffer at a time rather than
+        formatting each piece through stdio.
+*/
+#include <stdio.h>
+
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+/* Characters held before the buffer is written out. */
+#define OUTPUTBUFFERSIZE 65536
+
+/*
+    Held by its user, typically on the stack, so output needs no
+    allocation.
+*/
+struct outputBuffer {
+    FILE *out;
+    /* Characters held so far. */
+    size_t length;
+    char data[OUTPUTBUFFERSIZE];
+};
+
+/* Sets up the given buffer, empty, to write to out. */
+void newOutputBuffer(struct outputBuffer *ob, FILE *out);
+
+/* Adds the given length characters to the buffer. */
+void outputBufferWrite(struct outputBuffer *ob, const char *text, size_t length);
+
+/* Adds the given nul-terminated string to the buffer. */
+void outputBufferString(struct outputBuffer *ob, const char *text);
+
+/* Adds the given character to the buffer. */
+void outputBufferChar(struct outputBuffer *ob, char c);
+
+/* Adds the given integer, in decimal, to the buffer. */
+void outputBufferInt(struct outputBuffer *ob, int value);
+
+/* Writes everything held in the buffer to its file, leaving it empty. */
+void outputBufferFlush(struct outputBuffer *ob);
+
+#endif
@@ -15,7 +15,17 @@
 #include <string.h>
 #include <ctype.h>
 #include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "problem.h"
+#include "problemInternal.h"
+#include "termHash.h"
+#include "termTrie.h"
+#include "maxPlus.h"
+#include "arena.h"
+#include "tableParse.h"
+#include "outputBuffer.h"
 #include "problemStruct.c"
 #include "solutionStruct.c"
 
@@ -25,106 +35,125 @@
 /* Number of colour transitions to allocate space for initially. */
 #define INITIALTRANSITIONS 16
 
-/* -1 to show the colour hasn't been set. */
-#define DEFAULTCOLOUR (-1)
-/* -1 to be lower than zero to highlight in case accidentally used. */
-#define DEFAULTSCORE (-1)
-
-/* No colour is assigned where no highlighting rules are present. */
-#define NO_COLOUR (0)
-
 /* Marker for non-allowed colours. */
 #define NONALLOWED (INT_MIN / 2)
 
-/* Total number of colours is 4 */
-#define TOTAL_COLOURS 4
+/* Alignment of the transition matrix, one cache line. */
+#define MATRIXALIGNMENT 64
+
+/* Bits in each word of the allowed transition bitmask. */
+#define ALLOWEDWORDBITS 64
+
+/* Fewest terms worth giving a thread of their own in the parallel solvers. */
+#define PARALLELMINTERMS 256
 
 struct problem;
 struct solution;
 
-/* Sets up a solution for the given problem. */
-struct solution *newSolution(struct problem *problem);
-
 /* 
-    Reads the given text file into a set of tokens in a sentence 
-    and the given table file into a set of structs.
+    Compiles the rows of the given transition table into its dense
+    score matrix and allowed bitmask over colourCount colours.
+*/
+void compileTransitionMatrix(struct colourTransitionTable *t, int colourCount);
 
-    Assumption: Tables are always contiguous, meaning the table never
-    needs to be constructed 
+/* 
+    Widens the scores of every term colour table, and the shared row
+    for terms without a table, to cover colourCount colours.
 */
-struct problem *readProblemA(FILE *textFile, FILE *tableFile){
+void padColourTables(struct model *m, int colourCount);
+
+struct problem *newProblem(){
     struct problem *p = (struct problem *) malloc(sizeof(struct problem));
     assert(p);
+    p->termCount = 0;
+    p->text = NULL;
+    p->terms = NULL;
+    p->part = PART_A;
+    p->model = NULL;
+    p->ownsModel = 0;
+    p->arena = newArena();
+    return p;
+}
 
+struct model *newModel(){
+    struct model *m = (struct model *) malloc(sizeof(struct model));
+    assert(m);
+    m->termColourTableCount = 0;
+    m->colourTables = NULL;
+    m->termIndex = NULL;
+    m->termTrie = NULL;
+    m->maxTermLength = 0;
+    m->colourCount = 0;
+    m->noScores = NULL;
     /* Part B onwards so set as empty. */
-    p->colourTransitionTable = NULL;
-
-    int termCount = 0;
-    char *text = NULL;
-    char **terms = NULL;
-
-    int termColourTableCount = 0;
-    struct termColourTable *colourTables = NULL;
-
-    /* Read in text. */
-    size_t allocated = 0;
-    /* Exit if we read no characters or an error caught. */
-    int success = getdelim(&text, &allocated, '\0', textFile);
+    m->colourTransitionTable = NULL;
+    m->mapping = NULL;
+    m->mappingSize = 0;
+    return m;
+}
 
-    if(success == -1){
-        /* Encountered an error. */
-        perror("Encountered error reading text file");
-        exit(EXIT_FAILURE);
-    } else {
-        /* Assume file contains at least one character. */
-        assert(success > 0);
-    }
+/*
+    Reads the given table file into the model's term colour tables,
+    along with the hash index and trie over their terms. Returns 0
+    after reporting why if the file can't be read or a row is
+    malformed, leaving what was read in the model for freeModel.
 
+    Assumption: Tables are always contiguous, meaning the table never
+    needs to be constructed 
+*/
+int readTermColourTables(struct model *m, FILE *tableFile){
     char *tableText = NULL;
-    /* Reset allocated marker. */
-    allocated = 0;
-    success = getdelim(&tableText, &allocated, '\0', tableFile);
+    size_t allocated = 0;
+    int success = getdelim(&tableText, &allocated, '\0', tableFile);
 
     if(success == -1){
-        /* Encountered an error. */
-        // perror("Encountered error reading table file");
-        exit(EXIT_FAILURE);
-    } else {
-        /* Assume file contains at least one character. */
-        assert(success > 0);
+        /* Encountered an error, or the file is empty. */
+        if(ferror(tableFile)){
+            perror("Encountered error reading table file");
+        } else {
+            fprintf(stderr, "Error in table file: the file is empty\n");
+        }
+        free(tableText);
+        return 0;
     }
 
-    /* Read term table first. */
+    int termColourTableCount = 0;
+    struct termColourTable *colourTables = NULL;
     int allocatedColourTables = 0;
-    /* Progress through string. */
-    int progress = 0;
-    /* Table string length. */
-    int tableTextLength = strlen(tableText);
-    char *lastToken = NULL;
+    /* Rows are parsed one at a time from the whole table text. */
+    struct tableParser tp;
+    newTableParser(&tp, "table file", tableText, strlen(tableText));
     struct termColourTable *lastTable = NULL;
-
-    while(progress < tableTextLength){
-        char *token = NULL;
-        int score;
-        int colour;
-        int nextProgress;
-
-        int j = 0;
-        while(*(tableText + progress + j) != '\0' && *(tableText + progress + j) != ','){
-            j++;
+    /* Index over the tables built so far, so repeated terms join their table. */
+    struct termHash *termIndex = newTermHash(INITIALTERMS);
+    int maxTermLength = 0;
+    /* 
+        Rows for a term which doesn't directly follow its table only fill 
+        in colours that table hasn't set yet, matching the first table 
+        taking priority.
+    */
+    int joiningEarlierTable = 0;
+
+    const char *token;
+    int tokenLength;
+    int score;
+    int colour;
+    int parsed;
+    while((parsed = parseTableRow(&tp, &token, &tokenLength, &colour, &score)) > 0){
+        int sameAsLast = (lastTable != NULL && strncmp(token, lastTable->term, tokenLength) == 0 &&
+            lastTable->term[tokenLength] == '\0');
+        if(! sameAsLast){
+            int existing = termHashFindExact(termIndex, token, tokenLength);
+            if(existing != TERMHASH_NOT_FOUND){
+                lastTable = &(colourTables[existing]);
+                joiningEarlierTable = 1;
+                sameAsLast = 1;
+            }
         }
-        token = (char *) malloc(sizeof(char) * j);
-        assert(token);
-        /* Make sure a token, colour and score are grabbed for each line. For simplicity, freshly allocate the token. */
-        assert(sscanf(tableText + progress, "%[^,],%d,%d %n", token, &colour, &score, &nextProgress) == 3);
-        assert(nextProgress > 0);
-        progress += nextProgress;
 
-        if(lastToken == NULL || strcmp(token, lastToken) != 0){
+        if(! sameAsLast){
             /* New token, so build new table and add it to problem. */
-            // fprintf(stderr, "New token: %s (colour #%d) (%d)\n", token, colour, score);
-            lastToken = token;
-
+            // fprintf(stderr, "New token: %.*s (colour #%d) (%d)\n", tokenLength, token, colour, score);
             if(termColourTableCount == 0){
                 /* Allocate initial. */
                 colourTables = (struct termColourTable *) malloc(sizeof(struct termColourTable) * INITIALTERMS);
@@ -141,19 +170,19 @@ struct problem *readProblemA(FILE *textFile, FILE *tableFile){
             /* Set last table as fresh table. */
             lastTable = &(colourTables[termColourTableCount]);
             termColourTableCount++;
-            /* Initialise table. */
-            lastTable->term = token;
+            /* Initialise table, with its own copy of the token. */
+            lastTable->term = (char *) malloc(sizeof(char) * (tokenLength + 1));
+            assert(lastTable->term);
+            memcpy(lastTable->term, token, tokenLength);
+            lastTable->term[tokenLength] = '\0';
             lastTable->colourCount = 0;
             lastTable->colours = NULL;
             lastTable->scores = NULL;
-        } else {
-            /* Same as last token add info to new table. */
-            // fprintf(stderr, "Same token: %s (colour #%d) (%d)\n", token, colour, score);
-            /* Don't need token so free it. */
-            free(token);
-            token = NULL;
-            /* Connect with existing token. */
-            token = lastTable->term;
+            joiningEarlierTable = 0;
+            termHashInsert(termIndex, lastTable->term, termColourTableCount - 1);
+            if(tokenLength > maxTermLength){
+                maxTermLength = tokenLength;
+            }
         }
         /* See if we need to increase the space for colours and scores for those colours. */
         if(lastTable->colourCount <= colour){
@@ -162,15 +191,17 @@ struct problem *readProblemA(FILE *textFile, FILE *tableFile){
             assert(lastTable->colours);
             lastTable->scores = (int *) realloc(lastTable->scores, sizeof(int) * (colour + 1));
             assert(lastTable->scores);
-            for(int i = lastCount; i < colour; i++){
+            for(int i = lastCount; i <= colour; i++){
                 lastTable->colours[i] = DEFAULTCOLOUR;
                 lastTable->scores[i] = DEFAULTSCORE;
             }
             lastTable->colourCount = colour + 1;
         }
         /* Store info. */
-        (lastTable->colours)[colour] = colour;
-        (lastTable->scores)[colour] = score;
+        if(! joiningEarlierTable || (lastTable->colours)[colour] == DEFAULTCOLOUR){
+            (lastTable->colours)[colour] = colour;
+            (lastTable->scores)[colour] = score;
+        }
 
         /* Print new updated table */
         // fprintf(stderr, "Term: %s\n", lastTable->term);
@@ -179,6 +210,22 @@ struct problem *readProblemA(FILE *textFile, FILE *tableFile){
         //     fprintf(stderr, "%6d | %d\n", lastTable->colours[i], lastTable->scores[i]);
         // }
     }
+    if(parsed < 0){
+        /* Handed to the model so freeModel frees the tables read so far. */
+        free(tableText);
+        m->termColourTableCount = termColourTableCount;
+        m->colourTables = colourTables;
+        m->termIndex = termIndex;
+        return 0;
+    }
+
+    /* Colours are numbered from 0, so the highest colour given sets the count. */
+    int colourCount = 1;
+    for(int i = 0; i < termColourTableCount; i++){
+        if(colourTables[i].colourCount > colourCount){
+            colourCount = colourTables[i].colourCount;
+        }
+    }
 
     /* Compress table to not have empty tables. */
     if(colourTables){
@@ -187,124 +234,197 @@ struct problem *readProblemA(FILE *textFile, FILE *tableFile){
         allocatedColourTables = termColourTableCount;
     }
     
+    /* Build trie for greedy matching of terms in the text. */
+    struct termTrie *termTrie = newTermTrie();
+    for(int i = 0; i < termColourTableCount; i++){
+        termTrieInsert(termTrie, colourTables[i].term, i);
+    }
+
     /* Done with tableText */
     if(tableText){
         free(tableText);
     }
     
-    /* Now split into terms */
-    progress = 0;
-    int termsAllocated = 0;
-    int textLength = strlen(text);
-    while(progress < textLength){
-        /* This does greedy term matching - this generally follows the specification
-            but also allows for more complex cases (e.g. "Big Oh"). */
-        char *nextTerm = NULL;
-        int start;
-        int maxLengthGreedyMatch = 0;
-        int nextProgress;
-        while(text[progress] != '\0' && ! isalpha(text[progress])){
+    m->termColourTableCount = termColourTableCount;
+    m->colourTables = colourTables;
+    m->termIndex = termIndex;
+    m->termTrie = termTrie;
+    m->maxTermLength = maxTermLength;
+
+    padColourTables(m, colourCount);
+    return 1;
+}
+
+int nextTerm(struct problem *p, const char *text, int length, int final,
+    struct termSpan *term){
+    /* This does greedy term matching - this generally follows the specification
+        but also allows for more complex cases (e.g. "Big Oh"). */
+    int progress = 0;
+    int start;
+    int maxLengthGreedyMatch = 0;
+    term->start = 0;
+    term->length = 0;
+    term->table = TERMHASH_NOT_FOUND;
+    while(progress < length && ! isalpha(text[progress])){
+        progress++;
+    }
+    start = progress;
+    /* Calculate remaining character count to avoid edge case complications */
+    int remChars = length - start;
+    if(remChars == 0 || (! final && remChars <= p->model->maxTermLength)){
+        /* Only punctuation, or a term could run past the text given so far. */
+        return start;
+    }
+    /* See if any of the terms in the table match, taking the longest. */
+    maxLengthGreedyMatch = termTrieLongestMatch(p->model->termTrie, text + start, remChars, &(term->table));
+    if(maxLengthGreedyMatch > 0){
+        term->start = start;
+        term->length = maxLengthGreedyMatch;
+        progress += maxLengthGreedyMatch;
+        /* Move over punctuation if needed. */
+        while(progress < length && ! isalpha(text[progress])){
             progress++;
         }
-        start = progress;
-        /* Calculate remaining character count to avoid edge case complications */
-        int remChars = textLength - start;
-        /* See if any of the terms in the table match. */
-        for(int i = 0; i < termColourTableCount; i++){
-            char *term = colourTables[i].term;
-            int termLen = strlen(term);
-            if(termLen > remChars){
-                /* Not enough characters to fit term. */
-                continue;
-            }
-            /* Check if word boundary. */
-            if(!isalpha(text[progress + termLen])){
-                /* Yep! See if the term matches */
-                int matching = 1;
-                for(int j = 0; j < termLen; j++){
-                    if(tolower(text[progress + j]) != tolower(term[j])){
-                        /* Non-match */
-                        matching = 0;
-                        break;
-                    }
-                }
-                if(matching){
-                    /* Match, see if better than our current best. */
-                    if(termLen > maxLengthGreedyMatch){
-                        maxLengthGreedyMatch = termLen;
-                        nextTerm = term;
-                    }
-                }
-            }
-        }
-        if(! nextTerm){
-            /* No match found, try finding word. This may consume punctuation, 
-                this doesn't really matter. */
-            int j = 0;
-            while(isspace(*(text + start + j))){
-                j++;
-            }
-            while(*(text + start + j) != '\0' && ! isspace(*(text + start + j))){
-                j++;
-            }
-            // Wastes a little space, but shouldn't be too much.
-            nextTerm = (char *) malloc(sizeof(char) * j);
-            assert(nextTerm);
-            assert(sscanf(text + start, " %s %n", nextTerm, &nextProgress) == 1);
-            progress += nextProgress;
-        } else {
-            progress += maxLengthGreedyMatch;
-            /* Move over punctuation if needed. */
-            while(text[progress] != '\0' && ! isalpha(text[progress])){
-                progress++;
-            }
+        return progress;
+    }
+
+    /* No match found, try finding word. This may consume punctuation, 
+        this doesn't really matter. */
+    int j = 0;
+    while(start + j < length && text[start + j] != '\0' && ! isspace(text[start + j])){
+        j++;
+    }
+    if(! final && start + j == length && j <= p->model->maxTermLength){
+        /* The word may continue past the text given so far, and still be a term. */
+        return start;
+    }
+    term->start = start;
+    term->length = j;
+    progress = start + j;
+    while(progress < length && isspace(text[progress])){
+        progress++;
+    }
+    /* Words outside the greedy match can still be spelt exactly as a term. */
+    term->table = termHashFindExact(p->model->termIndex, text + start, j);
+    return progress;
+}
+
+/* Splits the problem's text into terms. */
+void tokenizeText(struct problem *p){
+    int termCount = 0;
+    struct termSpan *terms = NULL;
+    int termsAllocated = 0;
+    int progress = 0;
+    int textLength = strlen(p->text);
+    while(progress < textLength){
+        struct termSpan term;
+        int termProgress = progress;
+        progress += nextTerm(p, p->text + progress, textLength - progress, 1, &term);
+        if(term.length == 0){
+            /* Only trailing punctuation left. */
+            break;
         }
         if(termsAllocated == 0){
-            terms = (char **) malloc(sizeof(char *) * INITIALTERMS);
-            assert(terms);
+            terms = (struct termSpan *) arenaAlloc(p->arena, sizeof(struct termSpan) * INITIALTERMS);
             termsAllocated = INITIALTERMS;
         } else if(termCount >= termsAllocated) {
-            terms = (char **) realloc(terms, sizeof(char *) * termsAllocated * 2);
-            assert(terms);
+            /* Usually the last allocation, so grows in place. */
+            terms = (struct termSpan *) arenaGrow(p->arena, terms, sizeof(struct termSpan) * termsAllocated, 
+                sizeof(struct termSpan) * termsAllocated * 2);
             termsAllocated = termsAllocated * 2;
         }
-        terms[termCount] = nextTerm;
-        // fprintf(stderr, "(%s) ", nextTerm);
+        /* Spans are found relative to where the search started. */
+        term.start += termProgress;
+        terms[termCount] = term;
+        // fprintf(stderr, "(%.*s) ", term.length, p->text + term.start);
         termCount++;
     }
     // fprintf(stderr, "\n");
 
     p->termCount = termCount;
-    p->text = text;
     p->terms = terms;
+}
 
-    p->termColourTableCount = termColourTableCount;
-    p->colourTables = colourTables;
+/* 
+    Reads the given text file into a set of tokens in a sentence 
+    and the given table file into a set of structs.
+*/
+struct problem *readProblemA(FILE *textFile, FILE *tableFile){
+    struct problem *p = newProblem();
+
+    char *text = NULL;
+
+    /* Read in text. */
+    size_t allocated = 0;
+    /* Exit if we read no characters or an error caught. */
+    int success = getdelim(&text, &allocated, '\0', textFile);
+
+    if(success == -1){
+        /* Encountered an error. */
+        perror("Encountered error reading text file");
+        exit(EXIT_FAILURE);
+    } else {
+        /* Assume file contains at least one character. */
+        assert(success > 0);
+    }
+    p->text = (char *) arenaAlloc(p->arena, sizeof(char) * (success + 1));
+    memcpy(p->text, text, success + 1);
+    free(text);
+
+    p->model = newModel();
+    p->ownsModel = 1;
+    if(! readTermColourTables(p->model, tableFile)){
+        exit(EXIT_FAILURE);
+    }
+    tokenizeText(p);
 
     p->part = PART_A;
 
     return p;
 }
 
-struct problem *readProblemB(FILE *textFile, FILE *tableFile, 
-    FILE *transTable){
-    /* Fill in Part A sections. */
-    struct problem *p = readProblemA(textFile, tableFile);
-
-    /* Fill in Part B sections. */
-    p->colourTransitionTable = (struct colourTransitionTable *) malloc(sizeof(struct colourTransitionTable));
-    assert(p->colourTransitionTable);
+/*
+    Reads the given transition table into the model, compiling it
+    into its dense matrix over the model's colours. Returns 0 after
+    reporting why if the file can't be read or a row is malformed,
+    leaving what was read in the model for freeModel.
+*/
+int readColourTransitionTable(struct model *m, FILE *transTable){
+    m->colourTransitionTable = (struct colourTransitionTable *) malloc(sizeof(struct colourTransitionTable));
+    assert(m->colourTransitionTable);
     int transitionCount = 0;
     int transitionAllocated = 0;
     int *prevColours = NULL;
     int *colours = NULL;
     int *scores = NULL;
 
+    char *transText = NULL;
+    size_t allocated = 0;
+    ssize_t transTextLength = getdelim(&transText, &allocated, '\0', transTable);
+    m->colourTransitionTable->transitionCount = 0;
+    m->colourTransitionTable->prevColours = NULL;
+    m->colourTransitionTable->colours = NULL;
+    m->colourTransitionTable->scores = NULL;
+    m->colourTransitionTable->matrix = NULL;
+    m->colourTransitionTable->allowed = NULL;
+    if(transTextLength < 0){
+        if(ferror(transTable)){
+            perror("Encountered error reading transition table file");
+            free(transText);
+            return 0;
+        }
+        /* Empty file, so no transitions. */
+        transTextLength = 0;
+    }
+    struct tableParser tp;
+    newTableParser(&tp, "transition table file", transText, transTextLength);
+
     int prevColour;
     int colour;
     int score;
+    int parsed;
 
-    while(fscanf(transTable, "%d,%d,%d ", &prevColour, &colour, &score) == 3){
+    while((parsed = parseTransitionRow(&tp, &prevColour, &colour, &score)) > 0){
         if(transitionAllocated == 0){
             prevColours = (int *) malloc(sizeof(int) * INITIALTRANSITIONS);
             assert(prevColours);
@@ -328,15 +448,178 @@ struct problem *readProblemB(FILE *textFile, FILE *tableFile,
         transitionCount++;
     }
 
-    p->colourTransitionTable->transitionCount = transitionCount;
-    p->colourTransitionTable->prevColours = prevColours;
-    p->colourTransitionTable->colours = colours;
-    p->colourTransitionTable->scores = scores;
+    free(transText);
+
+    m->colourTransitionTable->transitionCount = transitionCount;
+    m->colourTransitionTable->prevColours = prevColours;
+    m->colourTransitionTable->colours = colours;
+    m->colourTransitionTable->scores = scores;
+    if(parsed < 0){
+        return 0;
+    }
+
+    /* The transition table may use colours no term has a score for. */
+    int colourCount = m->colourCount;
+    for(int i = 0; i < transitionCount; i++){
+        if(prevColours[i] >= colourCount){
+            colourCount = prevColours[i] + 1;
+        }
+        if(colours[i] >= colourCount){
+            colourCount = colours[i] + 1;
+        }
+    }
+    padColourTables(m, colourCount);
+    compileTransitionMatrix(m->colourTransitionTable, m->colourCount);
+    return 1;
+}
+
+struct problem *readProblemB(FILE *textFile, FILE *tableFile, 
+    FILE *transTable){
+    /* Fill in Part A sections. */
+    struct problem *p = readProblemA(textFile, tableFile);
+
+    /* Fill in Part B sections. */
+    if(! readColourTransitionTable(p->model, transTable)){
+        exit(EXIT_FAILURE);
+    }
 
     p->part = PART_B;
     return p;
 }
 
+struct problem *readStreamProblem(FILE *tableFile, FILE *transTable){
+    struct problem *p = newProblem();
+    p->model = readModel(tableFile, transTable);
+    if(! p->model){
+        exit(EXIT_FAILURE);
+    }
+    p->ownsModel = 1;
+    /* Decoded as Part F, one term at a time. */
+    p->part = PART_F;
+    return p;
+}
+
+struct model *readModel(FILE *tableFile, FILE *transTable){
+    struct model *m = newModel();
+    if(! readTermColourTables(m, tableFile) ||
+        (transTable && ! readColourTransitionTable(m, transTable))){
+        freeModel(m);
+        return NULL;
+    }
+    return m;
+}
+
+struct problem *readModelProblem(struct model *m, const char *text, int length, char part){
+    struct problem *p = newProblem();
+    switch(part){
+        case 'A':
+            p->part = PART_A;
+            break;
+        case 'B':
+            p->part = PART_B;
+            break;
+        case 'E':
+            p->part = PART_E;
+            break;
+        case 'F':
+            p->part = PART_F;
+            break;
+        default:
+            assert(0);
+    }
+    /* Only Part A can be solved without a transition table. */
+    assert(p->part == PART_A || m->colourTransitionTable);
+    p->model = m;
+    p->text = (char *) arenaAlloc(p->arena, sizeof(char) * (length + 1));
+    memcpy(p->text, text, length);
+    p->text[length] = '\0';
+    tokenizeText(p);
+    return p;
+}
+
+int modelSupportsPart(struct model *m, char part){
+    if(part == 'A'){
+        return 1;
+    }
+    if(part != 'B' && part != 'E' && part != 'F'){
+        return 0;
+    }
+    return m->colourTransitionTable != NULL;
+}
+
+struct problem *readProblemFromModel(FILE *textFile, struct model *m, char part){
+    char *text = NULL;
+    size_t allocated = 0;
+    int success = getdelim(&text, &allocated, '\0', textFile);
+    if(success == -1){
+        /* Encountered an error. */
+        perror("Encountered error reading text file");
+        exit(EXIT_FAILURE);
+    } else {
+        /* Assume file contains at least one character. */
+        assert(success > 0);
+    }
+    struct problem *p = readModelProblem(m, text, success, part);
+    free(text);
+    return p;
+}
+
+void compileTransitionMatrix(struct colourTransitionTable *t, int colourCount){
+    size_t matrixSize = sizeof(int) * colourCount * colourCount;
+    /* aligned_alloc needs a multiple of the alignment. */
+    matrixSize = (matrixSize + MATRIXALIGNMENT - 1) / MATRIXALIGNMENT * MATRIXALIGNMENT;
+    t->matrixColours = colourCount;
+    t->matrix = (int *) aligned_alloc(MATRIXALIGNMENT, matrixSize);
+    assert(t->matrix);
+    for(int i = 0; i < colourCount * colourCount; i++){
+        t->matrix[i] = DEFAULTSCORE;
+    }
+    t->allowedWords = (colourCount + ALLOWEDWORDBITS - 1) / ALLOWEDWORDBITS;
+    t->allowed = (uint64_t *) calloc(colourCount * t->allowedWords, sizeof(uint64_t));
+    assert(t->allowed);
+
+    for(int i = 0; i < t->transitionCount; i++){
+        int prevColour = t->prevColours[i];
+        int colour = t->colours[i];
+        if(prevColour < 0 || prevColour >= colourCount || colour < 0 || colour >= colourCount){
+            /* Outside the colours being solved for, so never looked up. */
+            continue;
+        }
+        uint64_t *word = t->allowed + prevColour * t->allowedWords + colour / ALLOWEDWORDBITS;
+        uint64_t bit = ((uint64_t) 1) << (colour % ALLOWEDWORDBITS);
+        if(*word & bit){
+            /* The first row given for a transition is the one used. */
+            continue;
+        }
+        *word |= bit;
+        t->matrix[prevColour * colourCount + colour] = t->scores[i];
+    }
+}
+
+void padColourTables(struct model *m, int colourCount){
+    for(int i = 0; i < m->termColourTableCount; i++){
+        struct termColourTable *t = &(m->colourTables[i]);
+        if(t->colourCount >= colourCount){
+            continue;
+        }
+        t->colours = (int *) realloc(t->colours, sizeof(int) * colourCount);
+        assert(t->colours);
+        t->scores = (int *) realloc(t->scores, sizeof(int) * colourCount);
+        assert(t->scores);
+        for(int j = t->colourCount; j < colourCount; j++){
+            t->colours[j] = DEFAULTCOLOUR;
+            t->scores[j] = DEFAULTSCORE;
+        }
+        t->colourCount = colourCount;
+    }
+    m->noScores = (int *) realloc(m->noScores, sizeof(int) * colourCount);
+    assert(m->noScores);
+    for(int j = 0; j < colourCount; j++){
+        m->noScores[j] = DEFAULTSCORE;
+    }
+    m->colourCount = colourCount;
+}
+
 struct problem *readProblemE(FILE *textFile, FILE *tableFile, 
     FILE *transTable){
     /* Interpretation of inputs is same as Part B. */
@@ -355,119 +638,326 @@ struct problem *readProblemF(FILE *textFile, FILE *tableFile,
     return p;
 }
 
-/*
-    Outputs the given solution to the given file. If colourMode is 1, the
-    sentence in the problem is coloured with the given solution colours.
-*/
-void outputProblem(struct problem *problem, struct solution *solution, FILE *stdout, 
-    int colourMode){
-    assert(problem->termCount == solution->termCount);
-    if(! colourMode){
-        switch(problem->part){
-            case PART_A:
-            case PART_B:
-            case PART_F:
-                for(int i = 0; i < problem->termCount; i++){
-                    if(i != 0){
-                        printf(" ");
-                    }
-                    printf("%d", solution->termColours[i]);
+/* Finds how the given term is spelled, as the tables spell it if it has one. */
+static const char *termSpelling(struct problem *problem, int term){
+    struct termSpan *span = &(problem->terms[term]);
+    if(span->table != TERMHASH_NOT_FOUND){
+        return problem->model->colourTables[span->table].term;
+    }
+    return problem->text + span->start;
+}
+
+/* Writes the solution's colours, or Part E's score, as space-separated ints. */
+static void outputText(struct outputBuffer *ob, struct problem *problem,
+    struct solution *solution){
+    switch(problem->part){
+        case PART_A:
+        case PART_B:
+        case PART_F:
+            for(int i = 0; i < problem->termCount; i++){
+                if(i != 0){
+                    outputBufferChar(ob, ' ');
                 }
-                printf("\n");
-                break;
+                outputBufferInt(ob, solution->termColours[i]);
+            }
+            outputBufferChar(ob, '\n');
+            break;
+
+        case PART_E:
+            outputBufferInt(ob, solution->score);
+            outputBufferChar(ob, '\n');
+            break;
+    }
+}
+
+/* Writes the terms coloured with ANSI terminal codes. */
+static void outputColour(struct outputBuffer *ob, struct problem *problem,
+    struct solution *solution){
+    const char *(COLOURS_FG[]) = { "\033[38;5;0m"  , "\033[38;5;0m",  "\033[38;5;0m",  "\033[38;5;0m"  };
+    const char *(COLOURS_BG[]) = { "\033[48;5;231m", "\033[48;5;10m", "\033[48;5;11m", "\033[48;5;12m" };
+    const char *COLOURS_FG_ERROR = "\033[38;5;1m";
+    const char *ENDCODE = "\033[0m";
+    const int colourCount = (int) (sizeof(COLOURS_FG) / sizeof(COLOURS_FG[0]));
+
+    for(int i = 0; i < problem->termCount; i++){
+        if(i != 0){
+            outputBufferChar(ob, ' ');
+        }
+        /* Place colour code */
+        if(solution->termColours[i] < 0 || solution->termColours[i] >= colourCount){
+            outputBufferString(ob, COLOURS_FG_ERROR);
+        } else {
+            outputBufferString(ob, COLOURS_FG[solution->termColours[i]]);
+            outputBufferString(ob, COLOURS_BG[solution->termColours[i]]);
+        }
+        outputBufferWrite(ob, termSpelling(problem, i), problem->terms[i].length);
+        outputBufferString(ob, ENDCODE);
+    }
+    outputBufferChar(ob, '\n');
+}
 
-            case PART_E:
-                printf("%d\n", solution->score);
-                break;
+/*
+    Writes one JSON object on its own line, with a span for each term
+    and the score. Colours without a value (every colour in Part E) and
+    scores without a value (every part but E, unless from
+    solveProblemKBest) are null.
+*/
+static void outputJSONL(struct outputBuffer *ob, struct problem *problem,
+    struct solution *solution){
+    outputBufferString(ob, "{\"terms\":[");
+    for(int i = 0; i < problem->termCount; i++){
+        if(i != 0){
+            outputBufferChar(ob, ',');
+        }
+        outputBufferString(ob, "{\"start\":");
+        outputBufferInt(ob, problem->terms[i].start);
+        outputBufferString(ob, ",\"length\":");
+        outputBufferInt(ob, problem->terms[i].length);
+        outputBufferString(ob, ",\"colour\":");
+        if(solution->termColours[i] == DEFAULTCOLOUR){
+            outputBufferString(ob, "null");
+        } else {
+            outputBufferInt(ob, solution->termColours[i]);
         }
+        outputBufferChar(ob, '}');
+    }
+    outputBufferString(ob, "],\"score\":");
+    if(solution->score != DEFAULTSCORE){
+        outputBufferInt(ob, solution->score);
     } else {
-        const char *(COLOURS_FG[]) = { "\033[38;5;0m"  , "\033[38;5;0m",  "\033[38;5;0m",  "\033[38;5;0m"  };
-        const char *(COLOURS_BG[]) = { "\033[48;5;231m", "\033[48;5;10m", "\033[48;5;11m", "\033[48;5;12m" };
-        const char *COLOURS_FG_ERROR = "\033[38;5;1m";
-        const char *ENDCODE = "\033[0m";
-        const int colourCount = (int) (sizeof(COLOURS_FG) / sizeof(COLOURS_FG[0]));
+        outputBufferString(ob, "null");
+    }
+    outputBufferString(ob, "}\n");
+}
+
+/*
+    Writes a binary record: the header, each term's colour, padding to
+    a multiple of four bytes and, if withSpans is 1, each term's start
+    and length. Everything is in the machine's own byte order.
+*/
+static void outputBinary(struct outputBuffer *ob, struct problem *problem,
+    struct solution *solution, int withSpans){
+    /* Colours fit a byte unless there are too many to leave one spare. */
+    int colourWidth = (problem->model->colourCount < UINT8_MAX) ? 1 : 2;
+    assert(problem->model->colourCount <= UINT16_MAX);
+    uint8_t header[BINARYRECORDHEADERSIZE];
+    memcpy(header, BINARYRECORDMAGIC, 4);
+    header[4] = (uint8_t) colourWidth;
+    header[5] = withSpans ? BINARYRECORDSPANS : 0;
+    header[6] = 0;
+    header[7] = 0;
+    uint32_t termCount = (uint32_t) problem->termCount;
+    int32_t score = solution->score;
+    memcpy(header + 8, &termCount, sizeof(termCount));
+    memcpy(header + 12, &score, sizeof(score));
+    outputBufferWrite(ob, (const char *) header, BINARYRECORDHEADERSIZE);
+
+    for(int i = 0; i < problem->termCount; i++){
+        int colour = solution->termColours[i];
+        if(colourWidth == 1){
+            uint8_t packed = (colour == DEFAULTCOLOUR) ? UINT8_MAX : (uint8_t) colour;
+            outputBufferChar(ob, (char) packed);
+        } else {
+            uint16_t packed = (colour == DEFAULTCOLOUR) ? UINT16_MAX : (uint16_t) colour;
+            outputBufferWrite(ob, (const char *) &packed, sizeof(packed));
+        }
+    }
+    for(int i = (problem->termCount * colourWidth) % 4; i > 0 && i < 4; i++){
+        outputBufferChar(ob, 0);
+    }
 
+    if(withSpans){
         for(int i = 0; i < problem->termCount; i++){
-            if(i != 0){
-                printf(" ");
-            }
-            /* Place colour code */
-            if(solution->termColours[i] < 0 || solution->termColours[i] >= colourCount){
-                printf("%s%s%s", COLOURS_FG_ERROR, problem->terms[i], ENDCODE);
-            } else {
-                printf("%s%s%s%s", COLOURS_FG[solution->termColours[i]], COLOURS_BG[solution->termColours[i]], problem->terms[i], ENDCODE);
-            }
+            uint32_t span[2] = { (uint32_t) problem->terms[i].start,
+                (uint32_t) problem->terms[i].length };
+            outputBufferWrite(ob, (const char *) span, sizeof(span));
         }
-        printf("\n");
     }
 }
 
+/* Writes the given characters with those special to HTML escaped. */
+static void outputHTMLText(struct outputBuffer *ob, const char *text, int length){
+    int written = 0;
+    for(int i = 0; i < length; i++){
+        const char *escape;
+        switch(text[i]){
+            case '&': escape = "&amp;"; break;
+            case '<': escape = "&lt;"; break;
+            case '>': escape = "&gt;"; break;
+            case '"': escape = "&quot;"; break;
+            case '\'': escape = "&#39;"; break;
+            default: continue;
+        }
+        outputBufferWrite(ob, text + written, i - written);
+        outputBufferString(ob, escape);
+        written = i + 1;
+    }
+    outputBufferWrite(ob, text + written, length - written);
+}
+
 /*
-    Frees the given solution and all memory allocated for it.
+    Writes a paragraph with each term in a span whose class names its
+    colour (e.g. colour2), or colourNone for a term without one.
 */
-void freeSolution(struct solution *solution, struct problem *problem){
-    if(solution){
-        if(solution->termColours){
-            free(solution->termColours);
+static void outputHTML(struct outputBuffer *ob, struct problem *problem,
+    struct solution *solution){
+    outputBufferString(ob, "<p>");
+    for(int i = 0; i < problem->termCount; i++){
+        if(i != 0){
+            outputBufferChar(ob, ' ');
         }
-        free(solution);
+        if(solution->termColours[i] == DEFAULTCOLOUR){
+            outputBufferString(ob, "<span class=\"colourNone\">");
+        } else {
+            outputBufferString(ob, "<span class=\"colour");
+            outputBufferInt(ob, solution->termColours[i]);
+            outputBufferString(ob, "\">");
+        }
+        outputHTMLText(ob, termSpelling(problem, i), problem->terms[i].length);
+        outputBufferString(ob, "</span>");
     }
+    outputBufferString(ob, "</p>\n");
+}
+
+int findOutputFormat(const char *name){
+    const char *(FORMAT_NAMES[]) = { "text", "colour", "jsonl", "binary",
+        "binary-spans", "html" };
+    const enum outputFormat FORMATS[] = { OUTPUT_TEXT, OUTPUT_COLOUR, OUTPUT_JSONL,
+        OUTPUT_BINARY, OUTPUT_BINARY_SPANS, OUTPUT_HTML };
+    for(int i = 0; i < (int) (sizeof(FORMATS) / sizeof(FORMATS[0])); i++){
+        if(strcmp(name, FORMAT_NAMES[i]) == 0){
+            return FORMATS[i];
+        }
+    }
+    return -1;
+}
+
+/*
+    Outputs the given solution to the given file in the given format,
+    one of those in enum outputFormat.
+*/
+void outputProblemFormat(struct problem *problem, struct solution *solution, FILE *out,
+    enum outputFormat format){
+    assert(problem->termCount == solution->termCount);
+    /* Everything is formatted into the buffer and written a buffer at a time. */
+    struct outputBuffer ob;
+    newOutputBuffer(&ob, out);
+    switch(format){
+        case OUTPUT_TEXT:
+            outputText(&ob, problem, solution);
+            break;
+
+        case OUTPUT_COLOUR:
+            outputColour(&ob, problem, solution);
+            break;
+
+        case OUTPUT_JSONL:
+            outputJSONL(&ob, problem, solution);
+            break;
+
+        case OUTPUT_BINARY:
+        case OUTPUT_BINARY_SPANS:
+            outputBinary(&ob, problem, solution, format == OUTPUT_BINARY_SPANS);
+            break;
+
+        case OUTPUT_HTML:
+            outputHTML(&ob, problem, solution);
+            break;
+    }
+    outputBufferFlush(&ob);
 }
 
 /*
-    Frees the given problem and all memory allocated for it.
+    Outputs the given solution to the given file. If colourMode is 1, the
+    sentence in the problem is coloured with the given solution colours,
+    otherwise it is written as text, as outputProblemFormat does for
+    OUTPUT_COLOUR and OUTPUT_TEXT.
+*/
+void outputProblem(struct problem *problem, struct solution *solution, FILE *stdout, 
+    int colourMode){
+    outputProblemFormat(problem, solution, stdout, colourMode ? OUTPUT_COLOUR : OUTPUT_TEXT);
+}
+
+int solutionScore(struct solution *solution){
+    return solution->score;
+}
+
+int problemTermCount(struct problem *problem){
+    return problem->termCount;
+}
+
+int problemColourCount(struct problem *problem){
+    return problem->model->colourCount;
+}
+
+/*
+    Frees the given solution and all memory allocated for it. Solutions
+    are allocated from their problem's arena, so are only released along
+    with the problem.
+*/
+void freeSolution(struct solution *solution, struct problem *problem){
+}
+
+/*
+    Frees the given problem and all memory allocated for it, including
+    its model if it was read along with the problem.
 */
 void freeProblem(struct problem *problem){
     if(problem){
-        /* Free terms. */
-        for(int i = 0; i < problem->termCount; i++){
-            /* Don't free terms in colour table as we'll get them later. */
-            int inTable = 0;
-            for(int j = 0; j < problem->termColourTableCount; j++){
-                /* Note we do == because we care about the pointer not the contents. */
-                if(problem->terms[i] == problem->colourTables[j].term){
-                    inTable = 1;
-                    break;
-                }
-            }
-            if(! inTable){
-                free(problem->terms[i]);
-            }
-        }
-        if(problem->terms){
-            free(problem->terms);
+        /* The text, terms, solutions and solver buffers are all in the arena. */
+        freeArena(problem->arena);
+        if(problem->ownsModel){
+            freeModel(problem->model);
         }
+        free(problem);
+    }
+}
 
-        for(int i = 0; i < problem->termColourTableCount; i++){
-            free(problem->colourTables[i].term);
-            if(problem->colourTables[i].colours){
-                free(problem->colourTables[i].colours);
-                free(problem->colourTables[i].scores);
+/*
+    Frees the given model and all memory allocated for it.
+*/
+void freeModel(struct model *m){
+    if(m && m->mapping){
+        /* Only the structs pointing into the mapping were allocated. */
+        free(m->colourTables);
+        freeTermHash(m->termIndex);
+        freeTermTrie(m->termTrie);
+        free(m->colourTransitionTable);
+        munmap(m->mapping, m->mappingSize);
+        free(m);
+    } else if(m){
+        for(int i = 0; i < m->termColourTableCount; i++){
+            free(m->colourTables[i].term);
+            if(m->colourTables[i].colours){
+                free(m->colourTables[i].colours);
+                free(m->colourTables[i].scores);
             }
         }
-        if(problem->colourTables){
-            free(problem->colourTables);
+        if(m->colourTables){
+            free(m->colourTables);
         }
-        if(problem->colourTransitionTable){
-            free(problem->colourTransitionTable->prevColours);
-            free(problem->colourTransitionTable->colours);
-            free(problem->colourTransitionTable->scores);
-            free(problem->colourTransitionTable);
+        freeTermHash(m->termIndex);
+        freeTermTrie(m->termTrie);
+        if(m->noScores){
+            free(m->noScores);
         }
-        if(problem->text){
-            free(problem->text);
+        if(m->colourTransitionTable){
+            free(m->colourTransitionTable->prevColours);
+            free(m->colourTransitionTable->colours);
+            free(m->colourTransitionTable->scores);
+            free(m->colourTransitionTable->matrix);
+            free(m->colourTransitionTable->allowed);
+            free(m->colourTransitionTable);
         }
-        free(problem);
+        free(m);
     }
 }
 
 /* Sets up a solution for the given problem */
 struct solution *newSolution(struct problem *problem){
-    struct solution *s = (struct solution *) malloc(sizeof(struct solution));
-    assert(s);
+    struct solution *s = (struct solution *) arenaAlloc(problem->arena, sizeof(struct solution));
     s->termCount = problem->termCount;
-    s->termColours = (int *) malloc(sizeof(int) * s->termCount);
-    assert(s->termColours);
+    s->termColours = (int *) arenaAlloc(problem->arena, sizeof(int) * s->termCount);
     for(int i = 0; i < s->termCount; i++){
         s->termColours[i] = DEFAULTCOLOUR;
     }
@@ -483,83 +973,55 @@ struct solution *solveProblemA(struct problem *p){
     struct solution *s = newSolution(p);
     
     for (int i = 0; i < p->termCount; i++) {
-        int score = DEFAULTSCORE;
+        int *wc = getWCRow(p, i);                          //scores of every colour for this term
         int maxscore = DEFAULTSCORE;
         int maxcolour = NO_COLOUR;  
 
-        for (int j = 0; j < p->termColourTableCount; j++) {
-            struct termColourTable *t = p->colourTables + j;
-
-            if (strcmp(p->terms[i],t->term) != 0) {        //if the term doesn't match in two tables,
-                continue;                                  //continues
-            }
-
-            for (int k = 0; k < t->colourCount; k++) {
-                for (int c = 0; c < TOTAL_COLOURS; c++) {
-                    if (t->colours[k] == c) {             //match the colours with the score
-                        score = t->scores[k];                    
-                    }
-
-                    if (score > maxscore) {               //if score is bigger than the maxscore,
-                        maxscore = score;                 //replace maxscore with score
-                        maxcolour = c;                    //maxcolour with colour now
-                    }
-                }
+        for (int c = 0; c < p->model->colourCount; c++) {
+            if (wc[c] > maxscore) {                        //if score is bigger than the maxscore,
+                maxscore = wc[c];                          //replace maxscore with score
+                maxcolour = c;                             //maxcolour with colour now
             }
         }
-        s->termColours[i] = maxcolour;                    //input maxcolour into solutions
+        s->termColours[i] = maxcolour;                     //input maxcolour into solutions
     }
     return s;
 }
 
-int getWC(struct problem *p, char* token, int colour) {   //get colours from the word colour table
-    for (int i = 0; i < p->termColourTableCount; i++) {
-        struct termColourTable *t = p->colourTables + i;
-
-        if (strcmp(token,t->term) != 0) {                 //if the term doesn't match in two tables,
-            continue;                                     //continue
-        }
-
-        for (int j = 0; j < t->colourCount; j++) {
-            if (t->colours[j] == colour) {            
-                return t->scores[j];
-            }
-        }
-    }
-    return DEFAULTSCORE;
+int *getWCRow(struct problem *p, int term) {               //get colours from the word colour table
+    return getTableWCRow(p, p->terms[term].table);         //table was found once when tokenizing
 }
 
-int getCT(struct problem *p, int prevColour, int colour) { //get colours from the colour transition table
-    struct colourTransitionTable *t = p->colourTransitionTable;
-    for (int i = 0; i < t->transitionCount; i++) {          
-        if (t->prevColours[i] == prevColour) {             
-            if (t->colours[i] == colour) {                 //if colours in two tables match,
-                return t->scores[i];                       //return the score in the current row
-            }
-        }
+int *getTableWCRow(struct problem *p, int table) {
+    if (table == TERMHASH_NOT_FOUND) {
+        return p->model->noScores;                         //every colour holds DEFAULTSCORE
     }
-    return DEFAULTSCORE;
+    return p->model->colourTables[table].scores;           //colours are stored at their own index
 }
 
 struct solution *solveProblemB(struct problem *p){
     struct solution *s = newSolution(p);
 
     int prevColour = DEFAULTCOLOUR;
+    int *ct = p->model->colourTransitionTable->matrix;
+    int colourCount = p->model->colourCount;
 
     for (int i = 0; i < p->termCount; i++) {              
+        int *wc = getWCRow(p, i);
         int maxscore = DEFAULTSCORE;
         int maxcolour = NO_COLOUR;  
-        char *token = p->terms[i];
 
-        for (int j = 0; j < TOTAL_COLOURS; j++) {
-            int getWCscore = getWC(p, token, j);
-            int getCTscore = getCT(p, prevColour, j);
+        for (int j = 0; j < colourCount; j++) {
+            int getCTscore = DEFAULTSCORE;                 //the first term has no previous colour
+            if (prevColour != DEFAULTCOLOUR) {
+                getCTscore = ct[prevColour * colourCount + j];
+            }
 
-            if (getWCscore == DEFAULTSCORE) {              //if score found in WC table is -1
+            if (wc[j] == DEFAULTSCORE) {                   //if score found in WC table is -1
                 continue;                                  //then continue
             }
 
-            int score = getWCscore + getCTscore;   
+            int score = wc[j] + getCTscore;   
             if (score > maxscore) {                        //if score is bigger than maxscore,
                 maxscore = score;                          //replace maxscore with score
                 maxcolour = j;                             //replace maxcolour with current colour
@@ -571,106 +1033,620 @@ struct solution *solveProblemB(struct problem *p){
     return s;
 }
 
-int **getDP(struct problem *p){
-    int **dp;
-    dp = (int **)malloc(sizeof(int *)*TOTAL_COLOURS);      //allocate memory for a 2D array
+/*
+    Backpointers recorded by the Viterbi pass. The entry for term i and
+    colour c is the colour of term i - 1 on the best path to term i 
+    coloured c. Entries take one byte when there are at most 256 colours,
+    otherwise two. Only terms from firstTerm onwards are kept, so a
+    segment of the text can be traced back on its own.
+*/
+struct backpointers {
+    int firstTerm;
+    int colourCount;
+    uint8_t *narrow;
+    uint16_t *wide;
+    /* Scratch column the kernel writes argmaxes into. */
+    int *from;
+};
+
+void newBackpointers(struct problem *p, struct backpointers *bp, int firstTerm, 
+    int termCount, int colourCount){
+    assert(colourCount <= UINT16_MAX + 1);
+    bp->firstTerm = firstTerm;
+    bp->colourCount = colourCount;
+    bp->narrow = NULL;
+    bp->wide = NULL;
+    if (colourCount <= UINT8_MAX + 1) {
+        bp->narrow = (uint8_t *)arenaAlloc(p->arena, sizeof(uint8_t)*termCount*colourCount);
+    } else {
+        bp->wide = (uint16_t *)arenaAlloc(p->arena, sizeof(uint16_t)*termCount*colourCount);
+    }
+    bp->from = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+}
 
-    for (int c = 0; c < TOTAL_COLOURS; c++) {
-        dp[c] = (int*)malloc(sizeof(int)*p->termCount);    //allocate memory for each colour
-        for (int i = 0; i < p->termCount; i++) {
-            dp[c][i] = DEFAULTSCORE;                       //intialise all blocks into -1
+/* Narrows the kernel's argmaxes into the entries for term i. */
+static inline void setBackpointers(struct backpointers *bp, int i){
+    int colourCount = bp->colourCount;
+    i -= bp->firstTerm;
+    if (bp->narrow) {
+        uint8_t *entries = bp->narrow + i * colourCount;
+        for (int c = 0; c < colourCount; c++) {
+            entries[c] = (uint8_t) bp->from[c];
+        }
+    } else {
+        uint16_t *entries = bp->wide + i * colourCount;
+        for (int c = 0; c < colourCount; c++) {
+            entries[c] = (uint16_t) bp->from[c];
         }
     }
-    for (int c = 0; c < TOTAL_COLOURS; c++) {
-        int getWCscore = getWC(p, p->terms[0], c);         //find score in WC table
-        dp[c][0] = getWCscore;                             //replace scores for all first terms
+}
+
+static inline int getBackpointer(struct backpointers *bp, int i, int colour){
+    i -= bp->firstTerm;
+    if (bp->narrow) {
+        return bp->narrow[i * bp->colourCount + colour];
     }
+    return bp->wide[i * bp->colourCount + colour];
+}
 
-    for (int i = 1; i < p->termCount; i++) {
-        char *token = p->terms[i];                         
-        
-        for (int c = 0; c < TOTAL_COLOURS; c++) {
-            int getWCscore = getWC(p, token, c);
-            int maxscore = DEFAULTSCORE;
+/*
+    Sets column to the DP scores of the first term, the term's own 
+    scores with colours it has no score for unreachable.
+*/
+void firstDPColumn(struct problem *p, int *column){
+    int *wc = getWCRow(p, 0);
+    for (int c = 0; c < p->model->colourCount; c++) {
+        column[c] = (wc[c] == DEFAULTSCORE) ? MAXPLUS_UNREACHABLE : wc[c];
+    }
+}
 
-            if (getWCscore == DEFAULTSCORE) {              //if score is -1 then continue
-                continue;
-            }
+/* 
+    Computes the DP column of term i from the column of term i - 1,
+    recording backpointers for term i if bp is not NULL.
+*/
+void nextDPColumn(struct problem *p, int i, const int *prevColumn, int *column,
+    struct backpointers *bp){
+    if (bp) {
+        maxPlusStepArgmax(prevColumn, p->model->colourTransitionTable->matrix, getWCRow(p, i), 
+            column, bp->from, p->model->colourCount);
+        setBackpointers(bp, i);
+    } else {
+        maxPlusStep(prevColumn, p->model->colourTransitionTable->matrix, getWCRow(p, i), 
+            column, p->model->colourCount);
+    }
+}
 
-            for (int j = 0; j < TOTAL_COLOURS; j++) {
-                int prevscore = dp[j][i - 1];            
-                
-                if (prevscore == DEFAULTSCORE) {           //if previous score is -1 then continue
-                    continue;
-                }
-                int getCTscore = getCT(p, j, c);           //get score from CT table
-                int score = getWCscore + getCTscore + prevscore;
+/*
+    Computes only the DP column of the last term, keeping two columns 
+    at a time. The returned column has colourCount entries. Backpointers
+    are recorded if bp is not NULL.
+*/
+int *getLastDPColumn(struct problem *p, struct backpointers *bp){
+    int colourCount = p->model->colourCount;
+    int *column = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+    int *prevColumn = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+    if (p->termCount == 0) {
+        for (int c = 0; c < colourCount; c++) {
+            column[c] = MAXPLUS_UNREACHABLE;
+        }
+        return column;
+    }
 
-                if (maxscore < score) {                    //replace maxscore if score is larger
-                    maxscore = score;
-                }
-            }
+    firstDPColumn(p, column);
+    for (int i = 1; i < p->termCount; i++) {
+        int *swap = prevColumn;                            //last column becomes the previous one
+        prevColumn = column;
+        column = swap;
+        nextDPColumn(p, i, prevColumn, column, bp);
+    }
+    return column;
+}
 
-            dp[c][i] = maxscore;                           //place maxscore into array
+int bestDPColour(struct problem *p, const int *column){
+    int maxscore = DEFAULTSCORE;
+    int maxcolour = DEFAULTCOLOUR;
+    for (int c = 0; c < p->model->colourCount; c++) {
+        if (maxscore < column[c]) {                        //replace maxscore if
+            maxscore = column[c];                          //maxscore < score of the last term
+            maxcolour = c;                                 //replace maxcolour with current colour
         }
     }
-    return dp;
+    return maxcolour;
 }
 
-void freeDP(int** dp) {
-    for (int c = 0; c < TOTAL_COLOURS; c++)                
-        free(dp[c]);                                       //free all block of colours
-    free(dp);                                              //and the array itselves
+/*
+    Walks the backpointers of every term back from the best colour in
+    the last term's DP column, writing the colours into tb.
+*/
+void traceBackpointers(struct problem *p, struct backpointers *bp, const int *column,
+    int *tb){
+    tb[p->termCount - 1] = bestDPColour(p, column);
+    if (tb[p->termCount - 1] != DEFAULTCOLOUR) {           //no colouring scores, leave the rest unset
+        for (int i = p->termCount - 1; i > 0; i--) {
+            tb[i - 1] = getBackpointer(bp, i, tb[i]);
+        }
+    }
 }
 
 struct solution *solveProblemE(struct problem *p){
     struct solution *s = newSolution(p);
-    int **dp = getDP(p);                                 
+    int *column = getLastDPColumn(p, NULL);                //only the last term's scores are needed
     
-    int i = p->termCount - 1;                              //the last term
-    int max = DEFAULTSCORE;                             
-    for (int c = 0; c < TOTAL_COLOURS; c++){
-        if (max < dp[c][i]) {                              //replace max with the largest score
-            max = dp[c][i];
-            s->score = max;                                //place max into solution
-        }
+    int c = bestDPColour(p, column);
+    if (c != DEFAULTCOLOUR) {
+        s->score = column[c];                              //place max into solution
     }
-    freeDP(dp);
     return s;
 }
 
 struct solution *solveProblemF(struct problem *p){
     struct solution *s = newSolution(p);
+    if (p->termCount == 0) {
+        return s;
+    }
     
-    int **dp = getDP(p);
-    int *tb = (int*)malloc(sizeof(int)*p->termCount);     //allocate memory for traceback array
-    int maxscore = DEFAULTSCORE;
-    int maxcolour = DEFAULTCOLOUR;
-    
-    for (int c = 0; c < TOTAL_COLOURS; c++) {
-        if (maxscore < dp[c][p->termCount - 1]) {         //replace maxscore if
-            maxscore = dp[c][p->termCount - 1];           //maxscore < score of the last term
-            maxcolour = c;                                //replace maxcolour with current colour
+    struct backpointers bp;
+    newBackpointers(p, &bp, 0, p->termCount, p->model->colourCount);
+    int *column = getLastDPColumn(p, &bp);                 //the path comes from the backpointers
+    int *tb = s->termColours;                              //trace back straight into the solution
+
+    traceBackpointers(p, &bp, column, tb);
+    return s;
+}
+
+/*
+    Finds the scores of every colour for term i, as getWCRow, with the
+    colours allowed doesn't allow for the term having no score, so the
+    kernel treats them as unreachable. Uses row for the copy if needed.
+*/
+static const int *getAllowedWCRow(struct problem *p, int i, const unsigned char *allowed,
+    int *row){
+    int *wc = getWCRow(p, i);
+    if (! allowed) {
+        return wc;
+    }
+    int colourCount = p->model->colourCount;
+    const unsigned char *termAllowed = allowed + (size_t) i * colourCount;
+    for (int c = 0; c < colourCount; c++) {
+        row[c] = termAllowed[c] ? wc[c] : DEFAULTSCORE;
+    }
+    return row;
+}
+
+/*
+    Solves Part F over only the colourings meeting the given constraints.
+    The DP column of a pinned term has only its pinned colour reachable,
+    so it is kept as that colour and its score. Stepping to a pinned term
+    is then one max over the previous column, or one addition after
+    another pinned term, and stepping from one is one addition per colour.
+    Only free terms after the first pay for a full kernel step, and only
+    they keep a column of backpointers.
+*/
+struct solution *solveProblemFConstrained(struct problem *p, const int *pinned,
+    const unsigned char *allowed){
+    struct solution *s = newSolution(p);
+    if (p->termCount == 0) {
+        return s;
+    }
+    int colourCount = p->model->colourCount;
+    int *matrix = p->model->colourTransitionTable->matrix;
+
+    /* Terms after the first, which each need a backpointer of some kind. */
+    int freeCount = 0;
+    int pinnedCount = 0;
+    for (int i = 0; i < p->termCount; i++) {
+        if (pinned && pinned[i] != DEFAULTCOLOUR) {
+            assert(pinned[i] >= 0 && pinned[i] < colourCount);
+            pinnedCount += (i > 0);
+        } else {
+            freeCount += (i > 0);
+        }
+    }
+    struct backpointers bp;
+    newBackpointers(p, &bp, 0, freeCount, colourCount);
+    /* The colour of the previous term on the best path to each pinned term. */
+    int *pinnedFrom = (int *)arenaAlloc(p->arena, sizeof(int)*pinnedCount);
+    int *row = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+    int *column = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+    int *prevColumn = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+
+    /* The pinned colour of the last term and its score, or DEFAULTCOLOUR if free. */
+    int lastPinned = DEFAULTCOLOUR;
+    int lastScore = MAXPLUS_UNREACHABLE;
+    const int *wc = getAllowedWCRow(p, 0, allowed, row);
+    if (pinned && pinned[0] != DEFAULTCOLOUR) {
+        lastPinned = pinned[0];
+        lastScore = (wc[lastPinned] == DEFAULTSCORE) ? MAXPLUS_UNREACHABLE : wc[lastPinned];
+    } else {
+        for (int c = 0; c < colourCount; c++) {
+            column[c] = (wc[c] == DEFAULTSCORE) ? MAXPLUS_UNREACHABLE : wc[c];
+        }
+    }
+
+    int freeIndex = 0;
+    int pinnedIndex = 0;
+    for (int i = 1; i < p->termCount; i++) {
+        wc = getAllowedWCRow(p, i, allowed, row);
+        if (pinned && pinned[i] != DEFAULTCOLOUR) {
+            int colour = pinned[i];
+            int best = MAXPLUS_UNREACHABLE;
+            int from = 0;
+            if (lastPinned != DEFAULTCOLOUR) {
+                best = lastScore + matrix[lastPinned * colourCount + colour];
+                from = lastPinned;
+            } else {
+                for (int j = 0; j < colourCount; j++) {
+                    int candidate = column[j] + matrix[j * colourCount + colour];
+                    if (candidate > best) {
+                        best = candidate;
+                        from = j;
+                    }
+                }
+            }
+            int score = best + wc[colour];
+            lastScore = (wc[colour] != DEFAULTSCORE && score > DEFAULTSCORE) ? score : MAXPLUS_UNREACHABLE;
+            lastPinned = colour;
+            pinnedFrom[pinnedIndex] = from;
+            pinnedIndex++;
+        } else {
+            if (lastPinned != DEFAULTCOLOUR) {
+                /* Only the pinned colour is reachable, so every colour comes from it. */
+                for (int c = 0; c < colourCount; c++) {
+                    int score = lastScore + matrix[lastPinned * colourCount + c] + wc[c];
+                    column[c] = (wc[c] != DEFAULTSCORE && score > DEFAULTSCORE) ? score : MAXPLUS_UNREACHABLE;
+                    bp.from[c] = lastPinned;
+                }
+                lastPinned = DEFAULTCOLOUR;
+            } else {
+                int *swap = prevColumn;
+                prevColumn = column;
+                column = swap;
+                maxPlusStepArgmax(prevColumn, matrix, wc, column, bp.from, colourCount);
+            }
+            setBackpointers(&bp, freeIndex);
+            freeIndex++;
+        }
+    }
+
+    int *tb = s->termColours;
+    if (lastPinned != DEFAULTCOLOUR) {
+        tb[p->termCount - 1] = (lastScore > DEFAULTSCORE) ? lastPinned : DEFAULTCOLOUR;
+    } else {
+        tb[p->termCount - 1] = bestDPColour(p, column);
+    }
+    if (tb[p->termCount - 1] != DEFAULTCOLOUR) {
+        for (int i = p->termCount - 1; i > 0; i--) {
+            if (pinned && pinned[i] != DEFAULTCOLOUR) {
+                pinnedIndex--;
+                tb[i - 1] = pinnedFrom[pinnedIndex];
+            } else {
+                freeIndex--;
+                tb[i - 1] = getBackpointer(&bp, freeIndex, tb[i]);
+            }
+        }
+    }
+    return s;
+}
+
+struct solution *solveProblem(struct problem *p){
+    switch(p->part){
+        case PART_A:
+            return solveProblemA(p);
+        case PART_B:
+            return solveProblemB(p);
+        case PART_E:
+            return solveProblemE(p);
+        case PART_F:
+            return solveProblemF(p);
+    }
+    assert(0);
+    return NULL;
+}
+
+/*
+    Solves Part F keeping the DP column of every interval-th term as a 
+    checkpoint, with interval about the square root of the term count. 
+    Traceback then recomputes one interval at a time from its checkpoint,
+    with backpointers for just that interval, last interval first. This
+    gives the same colours as solveProblemF in O(colourCount * sqrt(n))
+    memory besides the solution.
+*/
+struct solution *solveProblemFCheckpointed(struct problem *p){
+    struct solution *s = newSolution(p);
+    if (p->termCount == 0) {
+        return s;
+    }
+    int colourCount = p->model->colourCount;
+    int interval = 1;
+    while (interval * interval < p->termCount) {
+        interval++;
+    }
+    int checkpointCount = (p->termCount - 1) / interval + 1;
+    int *checkpoints = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount*checkpointCount);
+    int *column = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+    int *prevColumn = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+
+    /* Forward pass, checkpointing column k * interval as checkpoint k. */
+    firstDPColumn(p, column);
+    for (int i = 1; i < p->termCount; i++) {
+        if ((i - 1) % interval == 0) {
+            memcpy(checkpoints + (i - 1) / interval * colourCount, column, sizeof(int)*colourCount);
         }
+        int *swap = prevColumn;
+        prevColumn = column;
+        column = swap;
+        nextDPColumn(p, i, prevColumn, column, NULL);
+    }
+    if ((p->termCount - 1) % interval == 0) {
+        memcpy(checkpoints + (p->termCount - 1) / interval * colourCount, column, sizeof(int)*colourCount);
     }
 
-    tb[p->termCount - 1] = maxcolour;                     //replace colour of last term with maxcolour
-    for (int i = p->termCount - 1; i > 0; i--) {
-        for (int c = 0; c < TOTAL_COLOURS; c++) {
-            if (dp[c][i - 1] == DEFAULTSCORE) {           //if score of previous term is -1 the continue
+    int *tb = s->termColours;
+    tb[p->termCount - 1] = bestDPColour(p, column);
+    if (tb[p->termCount - 1] != DEFAULTCOLOUR) {
+        struct backpointers bp;
+        newBackpointers(p, &bp, 0, interval, colourCount);
+        /* Recompute terms after each checkpoint up to the next, then walk them back. */
+        for (int k = checkpointCount - 1; k >= 0; k--) {
+            int first = k * interval;
+            int last = first + interval;
+            if (last > p->termCount - 1) {
+                last = p->termCount - 1;
+            }
+            if (last == first) {
                 continue;
             }
-            int getWCscore = getWC(p, p->terms[i], tb[i]);
-            int getCTscore = getCT(p, c, tb[i]);
+            bp.firstTerm = first + 1;
+            memcpy(column, checkpoints + k * colourCount, sizeof(int)*colourCount);
+            for (int i = first + 1; i <= last; i++) {
+                int *swap = prevColumn;
+                prevColumn = column;
+                column = swap;
+                nextDPColumn(p, i, prevColumn, column, &bp);
+            }
+            for (int i = last; i > first; i--) {
+                tb[i - 1] = getBackpointer(&bp, i, tb[i]);
+            }
+        }
+    }
+    return s;
+}
+
+/*
+    A run of terms first to last (inclusive, first at least 1) solved
+    by one thread in the parallel solvers.
+*/
+struct dpSegment {
+    struct problem *p;
+    int first;
+    int last;
+    /*
+        transfer[j * colourCount + c] is the best score of terms first to
+        last with term first - 1 coloured j and term last coloured c, or
+        MAXPLUS_UNREACHABLE. Product of the segment's per term max-plus
+        matrices.
+    */
+    int *transfer;
+    /* DP columns of term first - 1 and term last. */
+    int *start;
+    int *end;
+    /* 1 if start is already known, so the segment is solved directly. */
+    int startKnown;
+    /* Cleared if a term's scores could be clamped, see getLastDPColumnParallel. */
+    int linear;
+    /* Shares the entries of the whole text's backpointers, or NULL. */
+    struct backpointers *bp;
+    /* Spares the segment's thread swaps with end and transfer while stepping. */
+    int *spareColumn;
+    int *spareTransfer;
+};
+
+/* Computes the segment's DP columns from its start column. */
+static void *solveSegment(void *arg){
+    struct dpSegment *seg = (struct dpSegment *) arg;
+    int colourCount = seg->p->model->colourCount;
+    memcpy(seg->end, seg->start, sizeof(int)*colourCount);
+    for (int i = seg->first; i <= seg->last; i++) {
+        int *swap = seg->spareColumn;
+        seg->spareColumn = seg->end;
+        seg->end = swap;
+        nextDPColumn(seg->p, i, seg->spareColumn, seg->end, seg->bp);
+    }
+    return NULL;
+}
+
+/*
+    Computes the segment's transfer matrix, stepping row j from a path
+    starting at colour j with score 0 through every term, or solves
+    the segment directly if its start is known.
+*/
+static void *transferSegment(void *arg){
+    struct dpSegment *seg = (struct dpSegment *) arg;
+    if (seg->startKnown) {
+        return solveSegment(seg);
+    }
+    struct problem *p = seg->p;
+    int colourCount = p->model->colourCount;
+    int *rows = seg->transfer;
+    int *nextRows = seg->spareTransfer;
+    for (int j = 0; j < colourCount; j++) {
+        for (int c = 0; c < colourCount; c++) {
+            rows[j * colourCount + c] = (c == j) ? 0 : MAXPLUS_UNREACHABLE;
+        }
+    }
+    for (int i = seg->first; i <= seg->last && seg->linear; i++) {
+        int *wc = getWCRow(p, i);
+        for (int c = 0; c < colourCount; c++) {
+            if (wc[c] < DEFAULTSCORE) {                    //could score below DEFAULTSCORE
+                seg->linear = 0;
+            }
+        }
+        for (int j = 0; j < colourCount; j++) {
+            maxPlusStep(rows + j * colourCount, p->model->colourTransitionTable->matrix, wc,
+                nextRows + j * colourCount, colourCount);
+        }
+        int *swap = rows;
+        rows = nextRows;
+        nextRows = swap;
+    }
+    seg->transfer = rows;
+    seg->spareTransfer = nextRows;
+    return NULL;
+}
+
+/* Runs work on every segment, the first on the calling thread. */
+static void runSegments(struct dpSegment *segs, int segCount, void *(*work)(void *)){
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t)*segCount);
+    assert(threads);
+    int *started = (int *)calloc(segCount, sizeof(int));
+    assert(started);
+    for (int k = 1; k < segCount; k++) {
+        started[k] = (pthread_create(&threads[k], NULL, work, &segs[k]) == 0);
+    }
+    work(&segs[0]);
+    for (int k = 1; k < segCount; k++) {
+        if (started[k]) {
+            pthread_join(threads[k], NULL);
+        } else {
+            work(&segs[k]);                                //no thread to spare, so do it here
+        }
+    }
+    free(threads);
+    free(started);
+}
+
+/*
+    As getLastDPColumn, splitting the terms into up to threadCount
+    segments solved on their own threads. The first segment is solved
+    directly, the rest each find their transfer matrix. The transfer
+    matrices then carry the first segment's last column through to the
+    start column of every segment, and the segments are solved again
+    from their start if backpointers are wanted.
+
+    The DP step is only a max-plus matrix product while no sum can fall
+    to DEFAULTSCORE or below and be made unreachable, which holds when
+    no transition is negative or missing and no term scores below 
+    DEFAULTSCORE. Otherwise, or with too few terms to be worth it, this
+    falls back to getLastDPColumn. Either way the columns and 
+    backpointers are the same as getLastDPColumn's. Finding the transfer
+    matrices takes colourCount times the work of the sequential DP, so
+    this only pays off with more threads than colours, and falls back to
+    getLastDPColumn with threadCount colours or fewer.
+*/
+int *getLastDPColumnParallel(struct problem *p, struct backpointers *bp, int threadCount){
+    int colourCount = p->model->colourCount;
+    int segCount = threadCount;
+    if (threadCount <= colourCount) {
+        segCount = 0;                                      //transfer matrices would cost more than they save
+    }
+    if (segCount > (p->termCount - 1) / PARALLELMINTERMS) {
+        segCount = (p->termCount - 1) / PARALLELMINTERMS;
+    }
+    for (int i = 0; i < colourCount * colourCount; i++) {
+        if (p->model->colourTransitionTable->matrix[i] < 0) {     //missing or negative transition
+            segCount = 0;
+        }
+    }
+    if (segCount < 2) {
+        return getLastDPColumn(p, bp);
+    }
+
+    /* Allocated here rather than on the segments' threads, as arenas are single threaded. */
+    struct dpSegment *segs = (struct dpSegment *)arenaAlloc(p->arena, sizeof(struct dpSegment)*segCount);
+    struct backpointers *segBps = NULL;
+    if (bp) {
+        segBps = (struct backpointers *)arenaAlloc(p->arena, sizeof(struct backpointers)*segCount);
+    }
+    int *columns = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount*(segCount + 1));
+    /* Terms 1 to termCount - 1 split as evenly as they go. */
+    int termsLeft = p->termCount - 1;
+    int first = 1;
+    for (int k = 0; k < segCount; k++) {
+        struct dpSegment *seg = &segs[k];
+        int length = termsLeft / (segCount - k);
+        seg->p = p;
+        seg->first = first;
+        seg->last = first + length - 1;
+        seg->transfer = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount*colourCount);
+        seg->start = columns + k * colourCount;
+        seg->end = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+        seg->spareColumn = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+        seg->spareTransfer = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount*colourCount);
+        seg->startKnown = (k == 0);
+        seg->linear = 1;
+        seg->bp = NULL;
+        if (bp) {
+            segBps[k] = *bp;                               //same entries, own scratch column
+            segBps[k].from = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+            if (k == 0) {
+                seg->bp = &segBps[k];
+            }
+        }
+        first += length;
+        termsLeft -= length;
+    }
+    firstDPColumn(p, segs[0].start);
 
-            if (getWCscore + getCTscore + dp[c][i - 1] == dp[tb[i]][i]) {
-                tb[i - 1] = c;
-                break;
+    runSegments(segs, segCount, transferSegment);
+    int linear = 1;
+    for (int k = 1; k < segCount; k++) {
+        linear = linear && segs[k].linear;
+    }
+
+    int *column = NULL;
+    if (linear) {
+        /* Carry the first segment's last column through the rest. */
+        int *zeros = (int *)arenaAlloc(p->arena, sizeof(int)*colourCount);
+        memset(zeros, 0, sizeof(int)*colourCount);
+        memcpy(segs[1].start, segs[0].end, sizeof(int)*colourCount);
+        for (int k = 1; k < segCount; k++) {
+            maxPlusStep(segs[k].start, segs[k].transfer, zeros, 
+                columns + (k + 1) * colourCount, colourCount);
+        }
+        if (bp) {
+            for (int k = 1; k < segCount; k++) {
+                segs[k].startKnown = 1;
+                segs[k].bp = &segBps[k];
             }
+            runSegments(segs + 1, segCount - 1, solveSegment);
         }
+        column = columns + segCount * colourCount;
+    }
+
+    if (! linear) {
+        return getLastDPColumn(p, bp);
+    }
+    return column;
+}
+
+struct solution *solveProblemEParallel(struct problem *p, int threadCount){
+    struct solution *s = newSolution(p);
+    int *column = getLastDPColumnParallel(p, NULL, threadCount);
+    
+    int c = bestDPColour(p, column);
+    if (c != DEFAULTCOLOUR) {
+        s->score = column[c];
     }
-    s->termColours = tb;
-    freeDP(dp);
     return s;
 }
 
+/*
+    Only the DP is split across threads. The traceback is one lookup per
+    term against the DP's colourCount squared steps, and each segment's
+    traceback needs the colour its next segment leaves at the boundary.
+    Finding those from the transfer matrices would have to break ties
+    exactly as the backpointers do to give solveProblemF's colours, so
+    the traceback is left serial.
+*/
+struct solution *solveProblemFParallel(struct problem *p, int threadCount){
+    struct solution *s = newSolution(p);
+    if (p->termCount == 0) {
+        return s;
+    }
+    
+    struct backpointers bp;
+    newBackpointers(p, &bp, 0, p->termCount, p->model->colourCount);
+    int *column = getLastDPColumnParallel(p, &bp, threadCount);
+    traceBackpointers(p, &bp, column, s->termColours);
+    return s;
+}
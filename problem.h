@@ -7,8 +7,12 @@
 */
 #include <stdio.h>
 
+#ifndef PROBLEM_H
+#define PROBLEM_H
+
 struct problem;
 struct solution;
+struct model;
 
 /* 
     Reads the given text file into a set of tokens in a sentence 
@@ -36,6 +40,50 @@ struct problem *readProblemE(FILE *textFile, FILE *tableFile,
 struct problem *readProblemF(FILE *textFile, FILE *tableFile, 
     FILE *transTable);
 
+/*
+    Reads the given table file and transition table into a problem
+    with no text yet, for decoding a stream of text as in Part F.
+*/
+struct problem *readStreamProblem(FILE *tableFile, FILE *transTable);
+
+/*
+    Reads the given table file, and the given transition table unless
+    it is NULL (as for Part A), into a model which can be shared by the
+    problems of many texts. The model is only read from once returned,
+    so texts can be read and solved against it on many threads at once.
+    Returns NULL after reporting why if a table can't be read or has a
+    malformed row, so a program which already has a model can keep it.
+*/
+struct model *readModel(FILE *tableFile, FILE *transTable);
+
+/*
+    Reads the first length characters of text into a problem to be 
+    solved against the given model as the given part ('A', 'B', 'E' 
+    or 'F'). The model must outlive the problem and is not freed with 
+    it; parts other than A need a model with a transition table.
+*/
+struct problem *readModelProblem(struct model *m, const char *text, int length, char part);
+
+/*
+    Returns 1 if texts can be read against the given model as the given
+    part, that is the part is one of 'A', 'B', 'E' or 'F' and the model
+    has a transition table if the part needs one, 0 otherwise.
+*/
+int modelSupportsPart(struct model *m, char part);
+
+/*
+    Reads the given text file into a problem to be solved against the
+    given model as the given part, as readModelProblem does.
+*/
+struct problem *readProblemFromModel(FILE *textFile, struct model *m, char part);
+
+/*
+    Solves the given problem according to the definition of the part
+    it was read for and places the solution output into a returned 
+    solution value.
+*/
+struct solution *solveProblem(struct problem *p);
+
 /*
     Solves the given problem according to Part A's definition
     and places the solution output into a returned solution value.
@@ -60,6 +108,46 @@ struct solution *solveProblemE(struct problem *p);
 */
 struct solution *solveProblemF(struct problem *p);
 
+/*
+    Solves the given problem according to Part F's definition, as
+    solveProblemF, over only the colourings meeting the given constraints.
+    If pinned is not NULL, term i must be coloured pinned[i] unless that
+    is -1. If allowed is not NULL, it holds a byte for each colour of each
+    term, term i's colour c at i * problemColourCount(p) + c, and term i
+    can only be coloured c if that byte is not 0. If no colouring meets
+    the constraints, every colour in the solution is -1. Runs of pinned 
+    terms cost little, so mostly pinned texts are solved quickly.
+*/
+struct solution *solveProblemFConstrained(struct problem *p, const int *pinned,
+    const unsigned char *allowed);
+
+/*
+    Solves the given problem according to Part F's definition, giving
+    the same solution as solveProblemF, but keeping only every 
+    sqrt(n)-th column of the DP and recomputing the rest during 
+    traceback. Uses memory proportional to the colour count times the 
+    square root of the term count, besides the solution itself.
+*/
+struct solution *solveProblemFCheckpointed(struct problem *p);
+
+/*
+    Solves the given problem according to Part E's definition, giving
+    the same solution as solveProblemE, splitting the text into 
+    segments solved on up to threadCount threads. Segments are joined
+    through their max-plus transfer matrices, which only holds when no
+    transition is negative or missing and no term scores below -1; 
+    otherwise, for short texts, or with no more threads than colours,
+    the text is solved on one thread.
+*/
+struct solution *solveProblemEParallel(struct problem *p, int threadCount);
+
+/*
+    As solveProblemEParallel, but according to Part F's definition,
+    giving the same solution as solveProblemF. The traceback through
+    the backpointers is done on one thread.
+*/
+struct solution *solveProblemFParallel(struct problem *p, int threadCount);
+
 /*
     Outputs the given solution to the given file. If colourMode is 1, the
     sentence in the problem is coloured with the given solution colours.
@@ -67,13 +155,87 @@ struct solution *solveProblemF(struct problem *p);
 void outputProblem(struct problem *problem, struct solution *solution, FILE *stdout, 
     int colourMode);
 
+/* Encodings a solution can be output in. */
+enum outputFormat {
+    /* Colours, or Part E's score, as space-separated ints on one line. */
+    OUTPUT_TEXT = 0,
+    /* The sentence coloured with ANSI terminal codes. */
+    OUTPUT_COLOUR = 1,
+    /*
+        One JSON object per line, e.g.
+        {"terms":[{"start":0,"length":5,"colour":1}],"score":null}
+        where start and length are byte offsets into the text, colour
+        is null for a term without one and score is null for a solution
+        without one (every solution outside Part E and k-best solving).
+    */
+    OUTPUT_JSONL,
+    /*
+        A binary record of BINARYRECORDHEADERSIZE header bytes, being
+        the magic BINARYRECORDMAGIC, a uint8 colour width (1 or 2 bytes),
+        a uint8 of flags, two zero bytes, a uint32 term count and an int32
+        score (-1 for a solution without one). The header is followed by
+        each term's colour, as an unsigned int of the colour width with
+        all bits set for no colour, then zero padding to a multiple of
+        four bytes.
+        All values are in the machine's own byte order.
+    */
+    OUTPUT_BINARY,
+    /*
+        As OUTPUT_BINARY, with BINARYRECORDSPANS set in the flags and
+        each term's uint32 start and uint32 length, as byte offsets into
+        the text, following the colours.
+    */
+    OUTPUT_BINARY_SPANS,
+    /*
+        A <p> line with each term in a <span> whose class names its
+        colour, e.g. class="colour2", or class="colourNone".
+    */
+    OUTPUT_HTML
+};
+
+#define BINARYRECORDMAGIC "CSNC"
+#define BINARYRECORDHEADERSIZE 16
+#define BINARYRECORDSPANS 0x01
+
+/*
+    Finds the output format named "text", "colour", "jsonl", "binary", 
+    "binary-spans" or "html", returning -1 if the name is none of these.
+*/
+int findOutputFormat(const char *name);
+
+/*
+    Outputs the given solution to the given file in the given format,
+    through a fixed-size buffer so no format holds the whole output.
+*/
+void outputProblemFormat(struct problem *problem, struct solution *solution, FILE *out,
+    enum outputFormat format);
+
+/*
+    Returns the score of the given solution, or -1 if it has none, as
+    for solutions outside Part E and k-best solving.
+*/
+int solutionScore(struct solution *solution);
+
+/* Returns the number of terms in the given problem's text. */
+int problemTermCount(struct problem *problem);
+
+/* Returns the number of colours in the given problem's tables. */
+int problemColourCount(struct problem *problem);
+
 /*
     Frees the given solution and all memory allocated for it.
 */
 void freeSolution(struct solution *solution, struct problem *problem);
 
 /*
-    Frees the given problem and all memory allocated for it.
+    Frees the given problem and all memory allocated for it, including
+    its model if it was read along with the problem.
 */
 void freeProblem(struct problem *problem);
 
+/*
+    Frees the given model and all memory allocated for it.
+*/
+void freeModel(struct model *m);
+
+#endif
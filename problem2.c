@@ -0,0 +1,879 @@
+/*
+    Make using
+        make problem2
+
+    Run using
+        ./problem2 parts table [ctt] < text
+
+        or
+
+        ./problem2 -m model parts < text
+
+    where parts is one or more of a, b, e and f (e.g. ef),
+        table is the colour table in the expected format
+        (e.g. test_cases/2f-1-table.txt), ctt is the
+        transition table in the expected format (e.g.
+        test_cases/2f-1-ctt.txt, not given if the only part
+        is a) and text is a file containing input text, for
+        example:
+
+        ./problem2 ef test_cases/2f-1-table.txt test_cases/2f-1-ctt.txt < test_cases/2f-1-text.txt
+
+    The tables and the text are read once, then the text is
+    solved as each part in the order given, writing the output
+    the problem2 program for each part would.
+
+    problem2a, problem2b, problem2e and problem2f are this
+    program built with PROGRAMPART set to their part, so take
+    no parts argument, as in
+        ./problem2f [options] table ctt < text
+
+    Options, given before the parts:
+        -c              colour terms in the terminal
+        -o format       write each output as text, colour, jsonl,
+                        binary, binary-spans or html (see
+                        enum outputFormat in problem.h)
+        -t threads      solve on this many threads; long texts
+                        are split between them for parts e and f,
+                        or with -b texts are shared between them
+                        (by default one, or one per processor
+                        with -b)
+        -l              solve part f with the low memory
+                        checkpointed solver, for very long texts;
+                        takes priority over -t
+        -k count        output that many of the best colourings
+                        for parts e and f, best first, one to a
+                        line, each line in text output starting
+                        with the score for part f; parts a and b
+                        are greedy, so have no next best
+        -p constraints  only give part f colourings meeting the
+                        constraints in the given file, one term a
+                        line, as in
+                            3,2
+                            5,1,2
+                        that is the term's index in the text from
+                        0 then the colours it may take; a term
+                        given one colour is pinned to it. -l, -t
+                        and -k are ignored for constrained texts
+        -b              input holds one text per line, each solved
+                        as each part, writing one output per text
+                        in the same order as the texts
+        -0              as -b, with texts separated by nul
+                        characters rather than newlines
+        -d directory    as -b, solving each file in the directory
+                        as a text, in order of file name
+        -m model        read the tables from a model file written
+                        by problem2compile, given in place of the
+                        table and ctt
+        -M cache        keep the tables in the given model file,
+                        which is read in place of the tables while
+                        it was written from the same table files,
+                        unchanged since, and written again from
+                        them otherwise
+        -s              write the time taken by each stage to
+                        stderr when done, one line of key=value
+                        pairs for loading the tables and one for
+                        each part, with throughput and the peak
+                        resident memory reached by then
+
+    problem2batch is this program built with PROGRAMBATCH set, so
+    solves texts as with -b unless -d is given, as in
+        ./problem2batch [options] parts table [ctt] < texts
+
+    With -b, -0 or -d, sending the process SIGHUP reloads the
+    tables, or the model file, from the same files in the
+    background. Texts read after the new tables are in use are
+    solved against them, while texts already being solved finish
+    against the old.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include "problem.h"
+#include "modelFile.h"
+#include "kBest.h"
+#include "liveModel.h"
+
+/* Number of texts read in before solving them together with -b. */
+#define BATCHDOCUMENTS 1024
+/* Most parts which can be given at once, each of a, b, e and f being given more than once. */
+#define MAXPARTS 16
+
+/* Time spent on each stage of a part, over every text, in nanoseconds. */
+struct partStats {
+    long long texts;
+    long long terms;
+    long long bytes;
+    long long tokenize;
+    long long solve;
+    long long output;
+    /* Most memory resident in the process once a text was solved, in kilobytes. */
+    long peakMemory;
+};
+
+struct run {
+    char parts[MAXPARTS + 1];
+    int partCount;
+    enum outputFormat format;
+    int threadCount;
+    int lowMemory;
+    int bestCount;
+    /* 1 if the time taken by each stage is to be written. */
+    int showStats;
+    /* Constraints on the colours of terms, if given. */
+    FILE *constraintFile;
+    struct model *model;
+    /* The tables texts are solved against with -b, which can be reloaded between texts. */
+    struct liveModel *liveModel;
+    struct partStats stats[MAXPARTS];
+};
+
+struct document {
+    char *text;
+    int length;
+    /* The output for the text as every part once solved. */
+    char *output;
+    size_t outputLength;
+};
+
+struct batch {
+    struct run *run;
+    struct document *documents;
+    int documentCount;
+    /* The next document for a thread to take. */
+    int next;
+    /* Threads started once for the run, which solve every batch beside the calling thread. */
+    pthread_t *threads;
+    int threadCount;
+    pthread_mutex_t lock;
+    /* Signalled when a new batch is ready, or the threads are to stop. */
+    pthread_cond_t ready;
+    /* Signalled when the last thread is done with a batch. */
+    pthread_cond_t done;
+    /* Counts the batches handed out, so a thread knows when there is a new one. */
+    int generation;
+    /* Threads still solving the current batch. */
+    int working;
+    int stopping;
+};
+
+/* Where texts are read from with -b. */
+struct textSource {
+    FILE *file;
+    char delimiter;
+    /* Directory entries, if reading from a directory. */
+    const char *directory;
+    struct dirent **entries;
+    int entryCount;
+    int nextEntry;
+};
+
+/* Returns the most memory resident in the process so far, in kilobytes. */
+static long peakMemory(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static long long nanoseconds(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+    Reads the constraints file for the given problem into pinned, with
+    a colour or -1 for each term, and allowed, left NULL unless a term
+    is given more than one colour. Returns 0 after reporting the first
+    line which isn't a valid constraint.
+*/
+int readConstraints(FILE *constraintFile, struct problem *problem, int **pinned,
+    unsigned char **allowed){
+    int termCount = problemTermCount(problem);
+    int colourCount = problemColourCount(problem);
+    *pinned = (int *) malloc(sizeof(int) * (termCount > 0 ? termCount : 1));
+    assert(*pinned);
+    for(int i = 0; i < termCount; i++){
+        (*pinned)[i] = -1;
+    }
+    *allowed = NULL;
+
+    char *line = NULL;
+    size_t lineAllocated = 0;
+    int lineNumber = 0;
+    while(getline(&line, &lineAllocated, constraintFile) > 0){
+        lineNumber++;
+        char *next = line;
+        while(*next == ' ' || *next == '\t'){
+            next++;
+        }
+        if(*next == '\n' || *next == '\r' || *next == '\0'){
+            continue;
+        }
+        char *end;
+        long term = strtol(next, &end, 10);
+        int colours[2] = { -1, -1 };
+        int colourTotal = 0;
+        int valid = (end != next && term >= 0 && term < termCount);
+        next = end;
+        while(valid && *next == ','){
+            long colour = strtol(next + 1, &end, 10);
+            valid = (end != next + 1 && colour >= 0 && colour < colourCount);
+            if(valid && colourTotal < 2){
+                colours[colourTotal] = (int) colour;
+            }
+            if(valid && colourTotal == 1){
+                /* A second colour makes this term's constraint a set. */
+                if(! *allowed){
+                    *allowed = (unsigned char *) malloc(sizeof(unsigned char) *
+                        (size_t) termCount * colourCount);
+                    assert(*allowed);
+                    memset(*allowed, 1, (size_t) termCount * colourCount);
+                }
+                memset(*allowed + term * colourCount, 0, colourCount);
+                (*allowed)[term * colourCount + colours[0]] = 1;
+            }
+            if(valid && colourTotal >= 1){
+                (*allowed)[term * colourCount + colour] = 1;
+            }
+            colourTotal += valid;
+            next = end;
+        }
+        while(valid && (*next == ' ' || *next == '\t' || *next == '\r')){
+            next++;
+        }
+        if(! valid || colourTotal == 0 || (*next != '\n' && *next != '\0')){
+            fprintf(stderr, "Line %d of the constraints file isn't a term index from 0 to %d "
+                "followed by colours from 0 to %d\n", lineNumber, termCount - 1, colourCount - 1);
+            free(line);
+            return 0;
+        }
+        if(colourTotal == 1){
+            (*pinned)[term] = colours[0];
+        }
+    }
+    free(line);
+    return 1;
+}
+
+/*
+    Solves the text as the given part of the run against the given
+    model, writing its output.
+    Texts are solved on threadCount threads where the part allows it.
+    Returns 0 if the constraints file isn't valid for the text.
+*/
+static int solveText(struct run *r, struct model *model, int partIndex, const char *text,
+    int length, FILE *out, int threadCount){
+    char part = r->parts[partIndex];
+    struct partStats *stats = &(r->stats[partIndex]);
+    long long start = nanoseconds();
+    struct problem *problem = readModelProblem(model, text, length, part);
+    long long tokenized = nanoseconds();
+    long long solved;
+
+    if(r->constraintFile && part == 'F'){
+        int *pinned;
+        unsigned char *allowed;
+        rewind(r->constraintFile);
+        if(! readConstraints(r->constraintFile, problem, &pinned, &allowed)){
+            freeProblem(problem);
+            return 0;
+        }
+        struct solution *solution = solveProblemFConstrained(problem, pinned, allowed);
+        solved = nanoseconds();
+        outputProblemFormat(problem, solution, out, r->format);
+        freeSolution(solution, problem);
+        free(pinned);
+        free(allowed);
+    } else if(r->bestCount > 0){
+        struct solution **solutions = (struct solution **) malloc(sizeof(struct solution *) * r->bestCount);
+        assert(solutions);
+        int found = solveProblemKBest(problem, r->bestCount, solutions);
+        solved = nanoseconds();
+        for(int i = 0; i < found; i++){
+            if(r->format == OUTPUT_TEXT && part == 'F'){
+                fprintf(out, "%d ", solutionScore(solutions[i]));
+            }
+            outputProblemFormat(problem, solutions[i], out, r->format);
+        }
+        free(solutions);
+    } else {
+        struct solution *solution;
+        if(part == 'F' && r->lowMemory){
+            solution = solveProblemFCheckpointed(problem);
+        } else if(part == 'F' && threadCount > 1){
+            solution = solveProblemFParallel(problem, threadCount);
+        } else if(part == 'E' && threadCount > 1){
+            solution = solveProblemEParallel(problem, threadCount);
+        } else {
+            solution = solveProblem(problem);
+        }
+        solved = nanoseconds();
+        outputProblemFormat(problem, solution, out, r->format);
+        freeSolution(solution, problem);
+    }
+    long long written = nanoseconds();
+
+    __atomic_fetch_add(&(stats->texts), 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->terms), problemTermCount(problem), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->bytes), length, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->tokenize), tokenized - start, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->solve), solved - tokenized, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->output), written - solved, __ATOMIC_RELAXED);
+    if(r->showStats){
+        long peak = peakMemory();
+        long seen = __atomic_load_n(&(stats->peakMemory), __ATOMIC_RELAXED);
+        while(peak > seen && ! __atomic_compare_exchange_n(&(stats->peakMemory), &seen, peak,
+            0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+        }
+    }
+    freeProblem(problem);
+    return 1;
+}
+
+/* Solves documents as every part until none are left in the batch. */
+static void *solveDocuments(void *arg){
+    struct batch *b = (struct batch *) arg;
+    int i;
+    while((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) < b->documentCount){
+        struct document *d = &(b->documents[i]);
+        int ticket;
+        struct model *model = acquireLiveModel(b->run->liveModel, &ticket);
+        FILE *output = open_memstream(&(d->output), &(d->outputLength));
+        assert(output);
+        for(int p = 0; p < b->run->partCount; p++){
+            solveText(b->run, model, p, d->text ? d->text : "", d->length, output, 1);
+        }
+        fclose(output);
+        releaseLiveModel(b->run->liveModel, ticket);
+    }
+    return NULL;
+}
+
+/* Solves each batch handed out by solveBatch, until stopPool is called. */
+static void *poolThread(void *arg){
+    struct batch *b = (struct batch *) arg;
+    int seen = 0;
+    pthread_mutex_lock(&b->lock);
+    while(1){
+        while(b->generation == seen && ! b->stopping){
+            pthread_cond_wait(&b->ready, &b->lock);
+        }
+        if(b->stopping){
+            break;
+        }
+        seen = b->generation;
+        pthread_mutex_unlock(&b->lock);
+        solveDocuments(b);
+        pthread_mutex_lock(&b->lock);
+        b->working--;
+        if(b->working == 0){
+            pthread_cond_signal(&b->done);
+        }
+    }
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+/* Starts the threads which, with the calling thread, solve every batch of the run. */
+static void startPool(struct batch *b, int threadCount){
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->ready, NULL);
+    pthread_cond_init(&b->done, NULL);
+    b->generation = 0;
+    b->working = 0;
+    b->stopping = 0;
+    b->threadCount = 0;
+    b->threads = (pthread_t *) malloc(sizeof(pthread_t) * (threadCount > 0 ? threadCount : 1));
+    assert(b->threads);
+    /* The calling thread solves documents too. */
+    for(int i = 1; i < threadCount; i++){
+        if(pthread_create(&(b->threads[b->threadCount]), NULL, poolThread, b) == 0){
+            b->threadCount++;
+        }
+    }
+}
+
+/* Stops the threads started by startPool once they are idle. */
+static void stopPool(struct batch *b){
+    pthread_mutex_lock(&b->lock);
+    b->stopping = 1;
+    pthread_cond_broadcast(&b->ready);
+    pthread_mutex_unlock(&b->lock);
+    for(int i = 0; i < b->threadCount; i++){
+        pthread_join(b->threads[i], NULL);
+    }
+    free(b->threads);
+    pthread_cond_destroy(&b->done);
+    pthread_cond_destroy(&b->ready);
+    pthread_mutex_destroy(&b->lock);
+}
+
+/*
+    Solves every document of the batch on the pool's threads and the
+    calling thread, returning once all are solved. Each thread takes the
+    next document from a shared counter; a document is a whole text
+    solved as every part, so taking one costs little beside solving it.
+*/
+static void solveBatch(struct batch *b){
+    pthread_mutex_lock(&b->lock);
+    b->next = 0;
+    b->working = b->threadCount;
+    b->generation++;
+    pthread_cond_broadcast(&b->ready);
+    pthread_mutex_unlock(&b->lock);
+    solveDocuments(b);
+    pthread_mutex_lock(&b->lock);
+    while(b->working > 0){
+        pthread_cond_wait(&b->done, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* Hidden files in a directory, including . and .., aren't texts. */
+static int isTextEntry(const struct dirent *entry){
+    return entry->d_name[0] != '.';
+}
+
+/*
+    Reads the next text into the given document, returning 0 if there
+    are no texts left.
+*/
+static int readDocument(struct textSource *source, struct document *d){
+    char *text = NULL;
+    size_t allocated = 0;
+    ssize_t length;
+    d->output = NULL;
+    d->outputLength = 0;
+    if(source->directory){
+        while(source->nextEntry < source->entryCount){
+            const char *name = source->entries[source->nextEntry]->d_name;
+            source->nextEntry++;
+            char *path = (char *) malloc(sizeof(char) * (strlen(source->directory) + strlen(name) + 2));
+            assert(path);
+            sprintf(path, "%s/%s", source->directory, name);
+            FILE *file = fopen(path, "r");
+            if(! file){
+                fprintf(stderr, "Text file \"%s\" was unable to be opened\n", path);
+                perror("Reason for file open failure");
+                exit(EXIT_FAILURE);
+            }
+            free(path);
+            /* Read the whole file, as a single text is. */
+            length = getdelim(&text, &allocated, '\0', file);
+            int failed = (length < 0 && ferror(file));
+            fclose(file);
+            if(failed){
+                /* Not a file which can be read, such as a directory. */
+                free(text);
+                text = NULL;
+                allocated = 0;
+                continue;
+            }
+            if(length < 0){
+                /* Empty file. */
+                length = 0;
+            }
+            d->text = text;
+            d->length = (int) length;
+            return 1;
+        }
+        return 0;
+    }
+
+    length = getdelim(&text, &allocated, source->delimiter, source->file);
+    if(length < 0){
+        free(text);
+        return 0;
+    }
+    if(length > 0 && text[length - 1] == source->delimiter){
+        length--;
+    }
+    d->text = text;
+    d->length = (int) length;
+    return 1;
+}
+
+/* Set when SIGHUP asks for the tables to be reloaded. */
+static volatile sig_atomic_t reloadRequested = 0;
+
+static void requestReload(int signalNumber){
+    reloadRequested = 1;
+}
+
+/*
+    Solves each text from the given source as every part, reloading the
+    model from modelPath, or the tables if it is NULL, when asked to by
+    SIGHUP.
+*/
+static void solveTexts(struct run *r, struct textSource *source, const char *tablePath,
+    const char *transPath, const char *modelPath){
+    struct batch b;
+    b.run = r;
+    b.documents = (struct document *) malloc(sizeof(struct document) * BATCHDOCUMENTS);
+    assert(b.documents);
+    struct sigaction reloadAction;
+    memset(&reloadAction, 0, sizeof(reloadAction));
+    reloadAction.sa_handler = requestReload;
+    /* Reading texts carries on rather than failing when the signal comes. */
+    reloadAction.sa_flags = SA_RESTART;
+    sigaction(SIGHUP, &reloadAction, NULL);
+    startPool(&b, r->threadCount);
+    do {
+        b.documentCount = 0;
+        while(b.documentCount < BATCHDOCUMENTS && readDocument(source, &(b.documents[b.documentCount]))){
+            b.documentCount++;
+        }
+        solveBatch(&b);
+        /* Outputs are written in the order the texts were read. */
+        for(int i = 0; i < b.documentCount; i++){
+            fwrite(b.documents[i].output, sizeof(char), b.documents[i].outputLength, stdout);
+            free(b.documents[i].output);
+            free(b.documents[i].text);
+        }
+        fflush(stdout);
+        if(reloadRequested){
+            reloadRequested = 0;
+            reloadLiveModel(r->liveModel, modelPath ? NULL : tablePath, modelPath ? NULL : transPath,
+                modelPath);
+        }
+    } while(b.documentCount == BATCHDOCUMENTS);
+    stopPool(&b);
+    free(b.documents);
+}
+
+/*
+    Reads the model cached at cachePath if it was written from these
+    tables as they are now and has every part given, otherwise reads
+    the tables and writes them to cachePath for next time. Returns NULL
+    if a table can't be opened or read. Sets *cached to 1 if the cached
+    model was used.
+*/
+static struct model *readCachedModel(const char *cachePath, const char *tablePath,
+    const char *transPath, const char *parts, int *cached){
+    struct model *m = NULL;
+    *cached = 0;
+    if(cachePath){
+        FILE *cacheFile = fopen(cachePath, "rb");
+        if(cacheFile){
+            m = mapModel(cacheFile);
+            fclose(cacheFile);
+        }
+        if(m && ! modelReadFrom(m, tablePath, transPath)){
+            /* Cached from other tables, or from these before they last changed. */
+            freeModel(m);
+            m = NULL;
+        }
+        for(int i = 0; m && parts[i]; i++){
+            if(! modelSupportsPart(m, parts[i])){
+                /* Cached from a table alone, but a transition table is needed now. */
+                freeModel(m);
+                m = NULL;
+            }
+        }
+        if(m){
+            *cached = 1;
+            return m;
+        }
+    }
+
+    FILE *tableFile = fopen(tablePath, "r");
+    if(! tableFile){
+        fprintf(stderr, "File given as table file was \"%s\", which was unable to be opened\n", tablePath);
+        perror("Reason for file open failure");
+        return NULL;
+    }
+    FILE *transFile = NULL;
+    if(transPath){
+        transFile = fopen(transPath, "r");
+        if(! transFile){
+            fprintf(stderr, "File given as transition table file was \"%s\", which was unable to be opened\n", transPath);
+            perror("Reason for file open failure");
+            fclose(tableFile);
+            return NULL;
+        }
+    }
+    m = readModel(tableFile, transFile);
+    fclose(tableFile);
+    if(transFile){
+        fclose(transFile);
+    }
+    if(! m){
+        return NULL;
+    }
+
+    if(cachePath){
+        /* The tables are still used if the cache can't be written. */
+        writeModelFile(m, cachePath, tablePath, transPath);
+    }
+    return m;
+}
+
+/* Writes the time taken by each stage to stderr. */
+static void writeStats(struct run *r, const char *source, long long loadTime, long loadMemory,
+    long long totalTime){
+    fprintf(stderr, "stage=load source=%s load_seconds=%.6f peak_rss_kb=%ld\n", source,
+        loadTime / 1e9, loadMemory);
+    for(int i = 0; i < r->partCount; i++){
+        struct partStats *s = &(r->stats[i]);
+        long long partTime = s->tokenize + s->solve + s->output;
+        /* Per term figures are over the whole part, so tokenizing and output are counted too. */
+        fprintf(stderr, "stage=part part=%c texts=%lld terms=%lld bytes=%lld tokenize_seconds=%.6f "
+            "solve_seconds=%.6f output_seconds=%.6f tokenize_mb_per_second=%.2f "
+            "solve_terms_per_second=%.0f ns_per_term=%.1f peak_rss_kb=%ld\n",
+            tolower((unsigned char) r->parts[i]), s->texts, s->terms, s->bytes, s->tokenize / 1e9,
+            s->solve / 1e9, s->output / 1e9,
+            s->tokenize > 0 ? s->bytes / 1e6 / (s->tokenize / 1e9) : 0.0,
+            s->solve > 0 ? s->terms / (s->solve / 1e9) : 0.0,
+            s->terms > 0 ? (double) partTime / s->terms : 0.0, s->peakMemory);
+    }
+    fprintf(stderr, "stage=total total_seconds=%.6f peak_rss_kb=%ld\n", totalTime / 1e9, peakMemory());
+}
+
+/* Reports how the program should be run. */
+static void usage(int argc){
+#ifdef PROGRAMPART
+    char name = (char) tolower(PROGRAMPART);
+    fprintf(stderr, "You only gave %d arguments to the program, \n"
+        "you should run the program with in the form \n"
+        "\t./problem2%c [-c] [-o format] [-l] [-k count] [-p constraints] [-t threads] [-b] [-0] [-M cache] [-s] %s < text\n"
+        "or\n"
+        "\t./problem2%c [options] -m model < text\n", argc, name,
+        (PROGRAMPART == 'A') ? "wordtable" : "wordtable transitiontable", name);
+#elif defined(PROGRAMBATCH)
+    fprintf(stderr, "You only gave %d arguments to the program, \n"
+        "you should run the program with in the form \n"
+        "\t./problem2batch [-c] [-o format] [-0] [-d directory] [-t threads] [-m model] [-M cache] [-s] parts [wordtable [transitiontable]] < texts\n", argc);
+#else
+    fprintf(stderr, "You only gave %d arguments to the program, \n"
+        "you should run the program with in the form \n"
+        "\t./problem2 [-c] [-o format] [-l] [-k count] [-p constraints] [-t threads] [-b] [-0] [-d directory] [-M cache] [-s] parts wordtable [transitiontable] < text\n"
+        "or\n"
+        "\t./problem2 [options] -m model parts < text\n", argc);
+#endif
+}
+
+int main(int argc, char **argv){
+    long long startTime = nanoseconds();
+    struct run r;
+    memset(&r, 0, sizeof(r));
+    r.format = OUTPUT_TEXT;
+    r.threadCount = 0;
+#ifdef PROGRAMBATCH
+    int batch = 1;
+#else
+    int batch = 0;
+#endif
+    struct textSource textSource = { stdin, '\n', NULL, NULL, 0, 0 };
+    /* Precompiled model file given in place of the tables, if any. */
+    const char *modelPath = NULL;
+    const char *cachePath = NULL;
+    const char *constraintPath = NULL;
+    int argIndex = 1;
+
+    while(argIndex < argc && argv[argIndex][0] == '-'){
+        char option = argv[argIndex][1];
+        const char *value = (argIndex + 1 < argc) ? argv[argIndex + 1] : NULL;
+        if(option == 'c'){
+            r.format = OUTPUT_COLOUR;
+        } else if(option == 'l'){
+            r.lowMemory = 1;
+        } else if(option == 'b'){
+            batch = 1;
+        } else if(option == '0'){
+            batch = 1;
+            textSource.delimiter = '\0';
+        } else if(option == 'd' && value){
+            batch = 1;
+            textSource.directory = value;
+            argIndex++;
+        } else if(option == 's'){
+            r.showStats = 1;
+        } else if(option == 'o' && value){
+            if(findOutputFormat(value) < 0){
+                fprintf(stderr, "Output format given was \"%s\", which is not one of "
+                    "text, colour, jsonl, binary, binary-spans or html\n", value);
+                return EXIT_FAILURE;
+            }
+            r.format = (enum outputFormat) findOutputFormat(value);
+            argIndex++;
+        } else if(option == 'k' && value){
+            r.bestCount = atoi(value);
+            if(r.bestCount < 1){
+                fprintf(stderr, "Count given for -k was \"%s\", which is not at least 1\n", value);
+                return EXIT_FAILURE;
+            }
+            argIndex++;
+        } else if(option == 't' && value){
+            r.threadCount = atoi(value);
+            argIndex++;
+        } else if(option == 'p' && value){
+            constraintPath = value;
+            argIndex++;
+        } else if(option == 'm' && value){
+            modelPath = value;
+            argIndex++;
+        } else if(option == 'M' && value){
+            cachePath = value;
+            argIndex++;
+        } else {
+            break;
+        }
+        argIndex++;
+    }
+
+#ifdef PROGRAMPART
+    r.parts[0] = PROGRAMPART;
+    r.partCount = 1;
+#else
+    if(argIndex >= argc){
+        usage(argc);
+        return EXIT_FAILURE;
+    }
+    for(const char *c = argv[argIndex]; *c; c++){
+        char part = (char) toupper((unsigned char) *c);
+        if((part != 'A' && part != 'B' && part != 'E' && part != 'F') || r.partCount == MAXPARTS){
+            fprintf(stderr, "Parts given were \"%s\", which is not up to %d of a, b, e and f\n",
+                argv[argIndex], MAXPARTS);
+            return EXIT_FAILURE;
+        }
+        r.parts[r.partCount] = part;
+        r.partCount++;
+    }
+    argIndex++;
+#endif
+    int needsTransitions = 0;
+    for(int i = 0; i < r.partCount; i++){
+        needsTransitions |= (r.parts[i] != 'A');
+        if(r.bestCount > 0 && r.parts[i] != 'E' && r.parts[i] != 'F'){
+            fprintf(stderr, "Part %c is solved greedily, so -k can only be given for parts e and f\n",
+                tolower((unsigned char) r.parts[i]));
+            return EXIT_FAILURE;
+        }
+    }
+
+    const char *tablePath = NULL;
+    const char *transPath = NULL;
+    if(! modelPath){
+        if(argIndex + needsTransitions >= argc){
+            usage(argc);
+            return EXIT_FAILURE;
+        }
+        tablePath = argv[argIndex];
+        if(needsTransitions){
+            transPath = argv[argIndex + 1];
+        } else if(argIndex + 1 < argc){
+            /* A transition table isn't needed for part a, but is used if given. */
+            transPath = argv[argIndex + 1];
+        }
+    }
+    if(constraintPath){
+        if(batch){
+            fprintf(stderr, "Constraints are given by the index of terms in a single text, so can't be given with -b\n");
+            return EXIT_FAILURE;
+        }
+        r.constraintFile = fopen(constraintPath, "r");
+        if(! r.constraintFile){
+            fprintf(stderr, "File given as constraints file was \"%s\", which was unable to be opened\n", constraintPath);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+    }
+    if(textSource.directory){
+        textSource.entryCount = scandir(textSource.directory, &textSource.entries, isTextEntry, alphasort);
+        if(textSource.entryCount < 0){
+            fprintf(stderr, "Directory given was \"%s\", which was unable to be read\n", textSource.directory);
+            perror("Reason for directory read failure");
+            return EXIT_FAILURE;
+        }
+    }
+    if(r.threadCount < 1){
+        r.threadCount = batch ? (int) sysconf(_SC_NPROCESSORS_ONLN) : 1;
+        if(r.threadCount < 1){
+            r.threadCount = 1;
+        }
+    }
+
+    long long loadStart = nanoseconds();
+    const char *source = "tables";
+    if(modelPath){
+        FILE *modelFile = fopen(modelPath, "rb");
+        if(! modelFile){
+            fprintf(stderr, "File given as model file was \"%s\", which was unable to be opened\n", modelPath);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+        r.model = mapModel(modelFile);
+        fclose(modelFile);
+        if(! r.model){
+            fprintf(stderr, "File given as model file was \"%s\", which is not a model file from problem2compile\n", modelPath);
+            return EXIT_FAILURE;
+        }
+        source = "model";
+    } else {
+        int cached;
+        r.model = readCachedModel(cachePath, tablePath, transPath, r.parts, &cached);
+        if(! r.model){
+            return EXIT_FAILURE;
+        }
+        if(cached){
+            source = "cache";
+        }
+    }
+    long long loadTime = nanoseconds() - loadStart;
+    long loadMemory = peakMemory();
+    for(int i = 0; i < r.partCount; i++){
+        if(! modelSupportsPart(r.model, r.parts[i])){
+            fprintf(stderr, "Part %c needs a transition table, which the model file has none of\n",
+                tolower((unsigned char) r.parts[i]));
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(batch){
+        r.liveModel = newLiveModel(r.model);
+        solveTexts(&r, &textSource, tablePath, transPath, modelPath);
+        /* The live model frees the tables in use by the end, which may have been reloaded. */
+        freeLiveModel(r.liveModel);
+        r.model = NULL;
+        for(int i = 0; i < textSource.entryCount; i++){
+            free(textSource.entries[i]);
+        }
+        free(textSource.entries);
+    } else {
+        char *text = NULL;
+        size_t allocated = 0;
+        ssize_t length = getdelim(&text, &allocated, '\0', stdin);
+        if(length < 0 && ferror(stdin)){
+            perror("Encountered error reading text file");
+            return EXIT_FAILURE;
+        }
+        for(int i = 0; i < r.partCount; i++){
+            if(! solveText(&r, r.model, i, text ? text : "", length > 0 ? (int) length : 0, stdout, r.threadCount)){
+                return EXIT_FAILURE;
+            }
+        }
+        free(text);
+    }
+    fflush(stdout);
+
+    if(r.showStats){
+        writeStats(&r, source, loadTime, loadMemory, nanoseconds() - startTime);
+    }
+    if(r.constraintFile){
+        fclose(r.constraintFile);
+    }
+    if(r.model){
+        freeModel(r.model);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+/*
+    Make using
+        make problem2client
+
+    Run using
+        ./problem2client socket < texts
+
+    where socket is the path of the Unix domain socket a
+        problem2server is listening on and texts is a file
+        containing one text per line, for example:
+
+        ./problem2client /tmp/colour.sock < texts.txt
+
+    Each text is sent to the server as a request, without
+    waiting for the responses to the texts before it, and the
+    responses are written in the same order as the texts, one
+    line for each, as in problem2batch. The client fails if the
+    server closes the connection before answering every text.
+
+    Options, given before the socket:
+        -p part         ask for each text to be solved as this
+                        part (a, b, e or f), rather than the
+                        server's default
+        -0              texts are separated by nul characters
+                        rather than newlines
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "problem.h"
+
+/* Characters of responses read at a time. */
+#define READSIZE 65536
+
+struct sender {
+    int fd;
+    FILE *texts;
+    char delimiter;
+    /* The part to ask for, or '\0' for the server's default. */
+    char part;
+    /* 1 if the server stopped taking requests before all were sent. */
+    int failed;
+    /* Number of requests sent. */
+    long sent;
+};
+
+/* Where the response counter is within a response. */
+enum responsePlace { RESPONSE_START, RESPONSE_LINE, RESPONSE_HEADER, RESPONSE_RECORD };
+
+/*
+    Counts the responses read so far, each either a line or, from a
+    server writing a binary format, a record sized by its header.
+*/
+struct responseCounter {
+    long count;
+    enum responsePlace place;
+    unsigned char header[BINARYRECORDHEADERSIZE];
+    int headerLength;
+    /* Characters of the current record left after its header. */
+    uint64_t recordLeft;
+};
+
+/* Returns the number of characters following the given binary record header. */
+static uint64_t recordSize(const unsigned char *header){
+    uint32_t termCount;
+    memcpy(&termCount, header + 8, sizeof(termCount));
+    uint64_t size = (uint64_t) termCount * header[4];
+    size += (4 - size % 4) % 4;
+    if(header[5] & BINARYRECORDSPANS){
+        size += (uint64_t) termCount * 2 * sizeof(uint32_t);
+    }
+    return size;
+}
+
+/* Counts the responses finished by the given characters. */
+static void countResponses(struct responseCounter *rc, const char *data, size_t length){
+    for(size_t i = 0; i < length; i++){
+        unsigned char c = (unsigned char) data[i];
+        switch(rc->place){
+            case RESPONSE_START:
+                if(c == (unsigned char) BINARYRECORDMAGIC[0]){
+                    rc->header[0] = c;
+                    rc->headerLength = 1;
+                    rc->place = RESPONSE_HEADER;
+                } else if(c == '\n'){
+                    rc->count++;
+                } else {
+                    rc->place = RESPONSE_LINE;
+                }
+                break;
+
+            case RESPONSE_LINE:
+                if(c == '\n'){
+                    rc->count++;
+                    rc->place = RESPONSE_START;
+                }
+                break;
+
+            case RESPONSE_HEADER:
+                if(rc->headerLength < 4 && c != (unsigned char) BINARYRECORDMAGIC[rc->headerLength]){
+                    /* A line starting as the magic does. */
+                    rc->place = RESPONSE_LINE;
+                    i--;
+                    break;
+                }
+                rc->header[rc->headerLength++] = c;
+                if(rc->headerLength == BINARYRECORDHEADERSIZE){
+                    rc->recordLeft = recordSize(rc->header);
+                    rc->place = RESPONSE_RECORD;
+                    if(rc->recordLeft == 0){
+                        rc->count++;
+                        rc->place = RESPONSE_START;
+                    }
+                }
+                break;
+
+            case RESPONSE_RECORD: {
+                /* The rest of the record is skipped over in one go. */
+                uint64_t skipped = length - i;
+                if(skipped > rc->recordLeft){
+                    skipped = rc->recordLeft;
+                }
+                rc->recordLeft -= skipped;
+                i += (size_t) skipped - 1;
+                if(rc->recordLeft == 0){
+                    rc->count++;
+                    rc->place = RESPONSE_START;
+                }
+                break;
+            }
+        }
+    }
+}
+
+/* Sends all the given characters, returning 0 if the socket failed. */
+static int sendAll(int fd, const char *data, size_t length){
+    while(length > 0){
+        ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return 0;
+        }
+        data += written;
+        length -= (size_t) written;
+    }
+    return 1;
+}
+
+/*
+    Sends each text as a request. Runs beside the reading of responses,
+    as the server stops reading requests when responses aren't read.
+*/
+static void *sendTexts(void *arg){
+    struct sender *s = (struct sender *) arg;
+    char *text = NULL;
+    size_t allocated = 0;
+    ssize_t length;
+    char header[32];
+    while((length = getdelim(&text, &allocated, s->delimiter, s->texts)) >= 0){
+        if(length > 0 && text[length - 1] == s->delimiter){
+            length--;
+        }
+        int headerLength;
+        if(s->part){
+            headerLength = sprintf(header, "%c %ld\n", s->part, (long) length);
+        } else {
+            headerLength = sprintf(header, "%ld\n", (long) length);
+        }
+        if(! sendAll(s->fd, header, (size_t) headerLength) || ! sendAll(s->fd, text, (size_t) length)){
+            s->failed = 1;
+            break;
+        }
+        s->sent++;
+    }
+    free(text);
+    /* Lets the server know no more requests are coming, so it closes once it has answered them. */
+    shutdown(s->fd, SHUT_WR);
+    return NULL;
+}
+
+int main(int argc, char **argv){
+    struct sender s = { -1, stdin, '\n', '\0', 0, 0 };
+    struct responseCounter responses = { 0, RESPONSE_START, { 0 }, 0, 0 };
+    int argIndex = 1;
+
+    while(argIndex < argc && argv[argIndex][0] == '-'){
+        if(argv[argIndex][1] == 'p' && argIndex + 1 < argc){
+            s.part = (char) tolower((unsigned char) argv[argIndex + 1][0]);
+            argIndex++;
+        } else if(argv[argIndex][1] == '0'){
+            s.delimiter = '\0';
+        } else {
+            break;
+        }
+        argIndex++;
+    }
+    if(argIndex >= argc || (s.part && s.part != 'a' && s.part != 'b' && s.part != 'e' && s.part != 'f')){
+        fprintf(stderr, "You only gave %d arguments to the program, \n"
+            "you should run the program with in the form \n"
+            "\t./problem2client [-p part] [-0] socket < texts\n", argc);
+        return EXIT_FAILURE;
+    }
+
+    struct sockaddr_un address;
+    if(strlen(argv[argIndex]) >= sizeof(address.sun_path)){
+        fprintf(stderr, "Socket path given was \"%s\", which is too long for a socket\n", argv[argIndex]);
+        return EXIT_FAILURE;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, argv[argIndex]);
+    s.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(s.fd < 0 || connect(s.fd, (struct sockaddr *) &address, sizeof(address)) < 0){
+        fprintf(stderr, "Socket given was \"%s\", which was unable to be connected to\n", argv[argIndex]);
+        perror("Reason for connection failure");
+        return EXIT_FAILURE;
+    }
+
+    pthread_t sendThread;
+    if(pthread_create(&sendThread, NULL, sendTexts, &s) != 0){
+        fprintf(stderr, "No thread could be started to send texts\n");
+        return EXIT_FAILURE;
+    }
+    char *buffer = (char *) malloc(sizeof(char) * READSIZE);
+    assert(buffer);
+    ssize_t got;
+    while((got = recv(s.fd, buffer, READSIZE, 0)) != 0){
+        if(got < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            perror("Reason for connection failure");
+            break;
+        }
+        countResponses(&responses, buffer, (size_t) got);
+        fwrite(buffer, sizeof(char), (size_t) got, stdout);
+    }
+    pthread_join(sendThread, NULL);
+    free(buffer);
+    close(s.fd);
+
+    if(s.failed || got < 0 || responses.count < s.sent){
+        fprintf(stderr, "The server closed the connection after answering %ld of the %ld texts sent\n",
+            responses.count, s.sent);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
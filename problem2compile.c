@@ -0,0 +1,75 @@
+/*
+    Make using
+        make problem2compile
+
+    Run using
+        ./problem2compile table ctt model
+
+        or
+
+        ./problem2compile table model
+
+    where table is the colour table in the expected
+        format (e.g. test_cases/2f-1-table.txt), ctt is
+        the transition table in the expected format
+        (e.g. test_cases/2f-1-ctt.txt, left out when only
+        solving Part A) and model is the model file to
+        write, for example:
+
+        ./problem2compile test_cases/2f-1-table.txt test_cases/2f-1-ctt.txt 2f-1.model
+
+    The model file holds the tables already read, along
+    with the indices over them, and can be given with -m
+    to problem2e, problem2f, problem2fstream and
+    problem2batch in place of the tables. A model file
+    already at the path is replaced rather than written over,
+    so programs using it keep the old tables until reloaded.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "problem.h"
+#include "modelFile.h"
+
+int main(int argc, char **argv){
+    FILE *tableFile = NULL;
+    FILE *transFile = NULL;
+
+    if(argc < 3 || argc > 4){
+        fprintf(stderr, "You gave %d arguments to the program, \n"
+            "you should run the program with in the form \n"
+            "\t./problem2compile wordtable [transitiontable] model\n", argc);
+        return EXIT_FAILURE;
+    }
+    tableFile = fopen(argv[1], "r");
+    if(! tableFile){
+        fprintf(stderr, "File given as table file was \"%s\", which was unable to be opened\n", argv[1]);
+        perror("Reason for file open failure");
+        return EXIT_FAILURE;
+    }
+    if(argc == 4){
+        transFile = fopen(argv[2], "r");
+        if(! transFile){
+            fprintf(stderr, "File given as transition table file was \"%s\", which was unable to be opened\n", argv[2]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct model *model = readModel(tableFile, transFile);
+    fclose(tableFile);
+    if(transFile){
+        fclose(transFile);
+    }
+    if(! model){
+        return EXIT_FAILURE;
+    }
+
+    /* Replaces any model file already there whole, as running programs may have it mapped. */
+    if(! writeModelFile(model, argv[argc - 1], argv[1], (argc == 4) ? argv[2] : NULL)){
+        return EXIT_FAILURE;
+    }
+
+    freeModel(model);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/*
+    Make using
+        make problem2fedit
+
+    Run using
+        ./problem2fedit table ctt edits < text
+
+        or
+
+        ./problem2fedit -m model edits < text
+
+    where table is the colour table in the expected
+        format (e.g. test_cases/2f-1-table.txt), ctt
+        is the transition table in the expected format
+        (e.g. test_cases/2f-1-ctt.txt), text is a file
+        containing input text and edits is a file of edits
+        to make to it, one to a line, as in
+            12,3,replacement text
+        which replaces the 3 characters of the text from
+        character 12 (from 0) with "replacement text". The
+        text inserted is the rest of the line, with \n for a
+        new line and \\ for a backslash.
+
+    Colours are written as in problem2f, once for the text
+    and again after each edit, re-solving only what each
+    edit changes.
+
+    The -m followed by a model file written by problem2compile
+    can be given in place of the table and ctt.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "problem.h"
+#include "modelFile.h"
+#include "incremental.h"
+
+#define DEFAULT_ARGV_TABLE_FILE 1
+#define DEFAULT_ARGV_TRANSITION_FILE 2
+#define DEFAULT_ARGV_EDIT_FILE 3
+
+/* Number of characters of text to allocate space for initially. */
+#define INITIALTEXT 4096
+
+/* Reads the whole of the given file, setting *length to its length. */
+char *readAll(FILE *file, int *length){
+    int allocated = INITIALTEXT;
+    char *text = (char *) malloc(sizeof(char) * allocated);
+    assert(text);
+    *length = 0;
+    size_t got;
+    while((got = fread(text + *length, sizeof(char), allocated - *length, file)) > 0){
+        *length += (int) got;
+        if(*length == allocated){
+            allocated = allocated * 2;
+            text = (char *) realloc(text, sizeof(char) * allocated);
+            assert(text);
+        }
+    }
+    return text;
+}
+
+/*
+    Reads the edit on the given line, unescaping the text to insert in
+    place. Returns 0 if the line isn't an edit.
+*/
+int readEdit(char *line, int *start, int *deleteLength, char **insert, int *insertLength){
+    char *end;
+    long value = strtol(line, &end, 10);
+    if(end == line || *end != ',' || value < 0){
+        return 0;
+    }
+    *start = (int) value;
+    line = end + 1;
+    value = strtol(line, &end, 10);
+    if(end == line || *end != ',' || value < 0){
+        return 0;
+    }
+    *deleteLength = (int) value;
+    *insert = end + 1;
+    int length = 0;
+    for(char *c = *insert; *c != '\0' && *c != '\n'; c++){
+        if(*c == '\\' && (c[1] == 'n' || c[1] == '\\')){
+            c++;
+            (*insert)[length] = (*c == 'n') ? '\n' : '\\';
+        } else {
+            (*insert)[length] = *c;
+        }
+        length++;
+    }
+    *insertLength = length;
+    return 1;
+}
+
+int main(int argc, char **argv){
+    FILE *tableFile = NULL;
+    FILE *transFile = NULL;
+    FILE *modelFile = NULL;
+    FILE *editFile = NULL;
+    struct model *model = NULL;
+    int editFileArgIndex = DEFAULT_ARGV_EDIT_FILE;
+
+    if(argc < 4){
+        fprintf(stderr, "You only gave %d arguments to the program, \n"
+            "you should run the program with in the form \n"
+            "\t./problem2fedit wordtable transitiontable edits < text\n"
+            "or\n"
+            "\t./problem2fedit -m model edits < text\n", argc);
+        return EXIT_FAILURE;
+    }
+    if(argv[1][0] == '-' && argv[1][1] == 'm'){
+        /* -m model takes the place of the table and transition table. */
+        modelFile = fopen(argv[2], "rb");
+        if(! modelFile){
+            fprintf(stderr, "File given as model file was \"%s\", which was unable to be opened\n", argv[2]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+    } else {
+        tableFile = fopen(argv[DEFAULT_ARGV_TABLE_FILE], "r");
+        if(! tableFile){
+            fprintf(stderr, "File given as table file was \"%s\", which was unable to be opened\n", argv[DEFAULT_ARGV_TABLE_FILE]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+        transFile = fopen(argv[DEFAULT_ARGV_TRANSITION_FILE], "r");
+        if(! transFile){
+            fprintf(stderr, "File given as transition table file was \"%s\", which was unable to be opened\n", argv[DEFAULT_ARGV_TRANSITION_FILE]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+    }
+    editFile = fopen(argv[editFileArgIndex], "r");
+    if(! editFile){
+        fprintf(stderr, "File given as edits file was \"%s\", which was unable to be opened\n", argv[editFileArgIndex]);
+        perror("Reason for file open failure");
+        return EXIT_FAILURE;
+    }
+
+    if(modelFile){
+        model = mapModel(modelFile);
+        fclose(modelFile);
+        if(! model){
+            fprintf(stderr, "File given as model file was \"%s\", which is not a model file from problem2compile\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    } else {
+        model = readModel(tableFile, transFile);
+        fclose(tableFile);
+        fclose(transFile);
+        if(! model){
+            return EXIT_FAILURE;
+        }
+    }
+
+    int length;
+    char *text = readAll(stdin, &length);
+    struct incrementalDocument *document = newIncrementalDocument(model, text, length);
+    free(text);
+    outputProblem(incrementalProblem(document), incrementalSolution(document), stdout, 0);
+
+    char *line = NULL;
+    size_t lineAllocated = 0;
+    int lineNumber = 0;
+    while(getline(&line, &lineAllocated, editFile) > 0){
+        lineNumber++;
+        int start, deleteLength, insertLength;
+        char *insert;
+        if(! readEdit(line, &start, &deleteLength, &insert, &insertLength)){
+            fprintf(stderr, "Line %d of the edits file isn't start,length,text\n", lineNumber);
+            return EXIT_FAILURE;
+        }
+        int textLength = incrementalTextLength(document);
+        if(start > textLength || deleteLength > textLength - start){
+            fprintf(stderr, "Line %d of the edits file is past the end of the text\n", lineNumber);
+            return EXIT_FAILURE;
+        }
+        incrementalEdit(document, start, deleteLength, insert, insertLength);
+        outputProblem(incrementalProblem(document), incrementalSolution(document), stdout, 0);
+    }
+    free(line);
+    fclose(editFile);
+
+    freeIncrementalDocument(document);
+    freeModel(model);
+
+    return EXIT_SUCCESS;
+}
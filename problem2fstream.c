@@ -0,0 +1,136 @@
+/*
+    Make using
+        make problem2fstream
+    
+    Run using
+        ./problem2fstream table ctt < text
+
+        or 
+
+        ./problem2fstream table ctt maxlag < text
+
+        or
+
+        ./problem2fstream -m model [maxlag] < text
+    
+    where table is the colour table in the expected
+        format (e.g. test_cases/2f-1-table.txt), ctt
+        is the transition table in the expected format
+        (e.g. test_cases/2f-1-ctt.txt) and text is a 
+        file or stream containing input text, for example:
+    
+        tail -f log.txt | ./problem2fstream test_cases/2f-1-table.txt test_cases/2f-1-ctt.txt
+    
+    Colours are written as in problem2f, but as soon as
+    they are known rather than once all text is read. The
+    optional maxlag is the most terms that can be read 
+    after a term before its colour is written regardless,
+    so these colours can differ from problem2f's. The
+    output also differs when a later term leaves no
+    colouring with a score: problem2f writes -1 for every
+    term, but colours already written stand and only the
+    terms after them are written as -1.
+
+    The -m followed by a model file written by problem2compile
+    can be given in place of the table and ctt.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include "problem.h"
+#include "modelFile.h"
+#include "stream.h"
+
+#define DEFAULT_ARGV_TABLE_FILE 1
+#define DEFAULT_ARGV_TRANSITION_FILE 2
+#define DEFAULT_ARGV_MAX_LAG 3
+
+/* Number of characters read from the text at a time. */
+#define READ_SIZE 65536
+
+int main(int argc, char **argv){
+    struct problem *problem;
+    struct streamDecoder *decoder;
+    FILE *tableFile = NULL;
+    FILE *transFile = NULL;
+    FILE *modelFile = NULL;
+    struct model *model = NULL;
+    int maxLag = STREAM_DEFAULT_MAX_LAG;
+
+    if(argc < 3){
+        fprintf(stderr, "You only gave %d arguments to the program, \n"
+            "you should run the program with in the form \n"
+            "\t./problem2fstream wordtable transitiontable [maxlag] < text\n"
+            "or\n"
+            "\t./problem2fstream -m model [maxlag] < text\n", argc);
+        return EXIT_FAILURE;
+    }
+    if(argv[1][0] == '-' && argv[1][1] == 'm'){
+        /* -m model takes the place of the table and transition table. */
+        modelFile = fopen(argv[2], "rb");
+        if(! modelFile){
+            fprintf(stderr, "File given as model file was \"%s\", which was unable to be opened\n", argv[2]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+    } else {
+        tableFile = fopen(argv[DEFAULT_ARGV_TABLE_FILE], "r");
+        /* Ensure the file was able to be successfully opened. */
+        if(! tableFile){
+            fprintf(stderr, "File given as table file was \"%s\", which was unable to be opened\n", argv[DEFAULT_ARGV_TABLE_FILE]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+        transFile = fopen(argv[DEFAULT_ARGV_TRANSITION_FILE], "r");
+        if(! transFile){
+            fprintf(stderr, "File given as transition table file was \"%s\", which was unable to be opened\n", argv[DEFAULT_ARGV_TRANSITION_FILE]);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+    }
+    if(argc > DEFAULT_ARGV_MAX_LAG){
+        maxLag = atoi(argv[DEFAULT_ARGV_MAX_LAG]);
+        if(maxLag < 1){
+            fprintf(stderr, "Maximum lag was \"%s\", it should be at least 1\n", argv[DEFAULT_ARGV_MAX_LAG]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(modelFile){
+        model = mapModel(modelFile);
+        fclose(modelFile);
+        if(! model){
+            fprintf(stderr, "File given as model file was \"%s\", which is not a model file from problem2compile\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        /* No text yet, it's fed to the decoder as it arrives. */
+        problem = readModelProblem(model, "", 0, 'F');
+    } else {
+        problem = readStreamProblem(tableFile, transFile);
+        fclose(tableFile);
+        fclose(transFile);
+    }
+
+    decoder = newStreamDecoder(problem, maxLag, stdout);
+
+    /* Read whatever is available rather than waiting for a full block. */
+    char *chunk = (char *) malloc(sizeof(char) * READ_SIZE);
+    assert(chunk);
+    ssize_t length;
+    while((length = read(STDIN_FILENO, chunk, READ_SIZE)) > 0){
+        streamDecoderFeed(decoder, chunk, (int) length);
+    }
+    if(length < 0){
+        perror("Encountered error reading text");
+        return EXIT_FAILURE;
+    }
+    streamDecoderFinish(decoder);
+
+    free(chunk);
+    freeStreamDecoder(decoder);
+    freeProblem(problem);
+    freeModel(model);
+
+    return EXIT_SUCCESS;
+}
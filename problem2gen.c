@@ -0,0 +1,223 @@
+/*
+    Make using
+        make problem2gen
+
+    Run using
+        ./problem2gen terms colours tokens table ctt text
+
+    where terms is the number of terms to put in the colour
+        table, colours is the number of colours (up to 64),
+        tokens is the number of terms to write to the text,
+        and table, ctt and text are the files to write the
+        colour table, transition table and text to, in the
+        forms the problem2 programs read, for example:
+
+        ./problem2gen 100000 16 1000000 table.txt ctt.txt text.txt
+
+    Terms are made up words, some of which are made of two or
+    three words. Each term is given a score for a few of the
+    colours, and every pair of colours a transition score, so
+    every part can be solved against the tables. The text is
+    terms picked at random, with some punctuation between them.
+    Every score is at least 0 and every transition is given,
+    so every text has a colouring with a score in parts e and
+    f. The same arguments always give the same files.
+
+    Options, given before the terms:
+        -s seed         seed for the random choices, 1 by default
+        -w percent      percentage of terms made of more than one
+                        word, 10 by default
+        -u percent      percentage of words in the text which
+                        aren't terms, 0 by default; a word which
+                        isn't a term has no colour with a score,
+                        so any text holding one has no colouring
+                        with a score in parts e and f
+        -r rows         most colours any one term is given a score
+                        for, 4 by default
+        -l tokens       write a new line after this many tokens,
+                        for texts too large to solve at once which
+                        are given to problem2 -b, by default the
+                        text is one line
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+
+/* Most colours a table can be generated with. */
+#define MAXGENCOLOURS 64
+/* Words are at least this many letters, so short terms don't all start longer ones. */
+#define MINWORDLETTERS 4
+/* Most score given for a colour or a transition. */
+#define MAXSCORE 20
+
+/* Mixes the given value into a well spread one, as in splitmix64. */
+static uint64_t mix(uint64_t x){
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+struct generator {
+    long long terms;
+    int colours;
+    long long tokens;
+    uint64_t seed;
+    int multiWordPercent;
+    int unknownPercent;
+    int maxRows;
+    long long lineTokens;
+    /* State of the random choices for the text. */
+    uint64_t state;
+};
+
+static uint64_t nextRandom(struct generator *g){
+    g->state = mix(g->state);
+    return g->state;
+}
+
+/* Writes the word with the given index, a distinct run of letters for each index. */
+static void writeWord(FILE *out, uint64_t index){
+    char letters[16];
+    int length = 0;
+    do {
+        letters[length] = (char) ('a' + index % 26);
+        index /= 26;
+        length++;
+    } while(index > 0 || length < MINWORDLETTERS);
+    for(int i = length - 1; i >= 0; i--){
+        putc(letters[i], out);
+    }
+}
+
+/*
+    Writes the term with the given index, which is its own word unless
+    it is one of the terms made of more than one word, whose other
+    words are those of other terms.
+*/
+static void writeTerm(FILE *out, struct generator *g, long long term){
+    uint64_t h = mix(g->seed ^ (uint64_t) term);
+    writeWord(out, (uint64_t) term);
+    if((long long) (h % 100) < g->multiWordPercent){
+        int extraWords = 1 + (int) ((h >> 8) % 2);
+        for(int i = 0; i < extraWords; i++){
+            putc(' ', out);
+            writeWord(out, mix(h + i) % (uint64_t) g->terms);
+        }
+    }
+}
+
+static void writeTable(FILE *out, struct generator *g){
+    for(long long term = 0; term < g->terms; term++){
+        uint64_t h = mix(g->seed * 31 + (uint64_t) term);
+        int rows = 1 + (int) (h % (uint64_t) g->maxRows);
+        /* Colours in order from a random first one, so none repeat. */
+        int first = (int) ((h >> 16) % (uint64_t) g->colours);
+        for(int row = 0; row < rows; row++){
+            writeTerm(out, g, term);
+            fprintf(out, ",%d,%d\n", (first + row) % g->colours,
+                (int) (mix(h + row) % (MAXSCORE + 1)));
+        }
+    }
+}
+
+static void writeTransitions(FILE *out, struct generator *g){
+    for(int prev = 0; prev < g->colours; prev++){
+        for(int colour = 0; colour < g->colours; colour++){
+            uint64_t h = mix(g->seed * 131 + (uint64_t) (prev * MAXGENCOLOURS + colour));
+            fprintf(out, "%d,%d,%d\n", prev, colour, (int) (h % (MAXSCORE + 1)));
+        }
+    }
+}
+
+static void writeText(FILE *out, struct generator *g){
+    g->state = g->seed;
+    for(long long token = 0; token < g->tokens; token++){
+        uint64_t r = nextRandom(g);
+        if(token > 0){
+            if(g->lineTokens > 0 && token % g->lineTokens == 0){
+                putc('\n', out);
+            } else {
+                /* Some punctuation, which tokenizing skips over. */
+                if(r % 16 == 0){
+                    putc((r >> 4) % 2 ? ',' : '.', out);
+                }
+                putc(' ', out);
+            }
+        }
+        if((long long) ((r >> 8) % 100) < g->unknownPercent){
+            /* Past the last term, so never in the table. */
+            writeWord(out, (uint64_t) g->terms + (r >> 16) % 1000);
+        } else {
+            writeTerm(out, g, (long long) ((r >> 16) % (uint64_t) g->terms));
+        }
+    }
+    putc('\n', out);
+}
+
+/* Opens the given file for writing, exiting if it can't be. */
+static FILE *openOutput(const char *path, const char *description){
+    FILE *file = fopen(path, "w");
+    if(! file){
+        fprintf(stderr, "File given as %s was \"%s\", which was unable to be opened\n", description, path);
+        perror("Reason for file open failure");
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+int main(int argc, char **argv){
+    struct generator g = { 0, 0, 0, 1, 10, 0, 4, 0, 0 };
+    int argIndex = 1;
+
+    while(argIndex + 1 < argc && argv[argIndex][0] == '-'){
+        if(argv[argIndex][1] == 's'){
+            g.seed = (uint64_t) strtoull(argv[argIndex + 1], NULL, 10);
+        } else if(argv[argIndex][1] == 'w'){
+            g.multiWordPercent = atoi(argv[argIndex + 1]);
+        } else if(argv[argIndex][1] == 'u'){
+            g.unknownPercent = atoi(argv[argIndex + 1]);
+        } else if(argv[argIndex][1] == 'r'){
+            g.maxRows = atoi(argv[argIndex + 1]);
+        } else if(argv[argIndex][1] == 'l'){
+            g.lineTokens = atoll(argv[argIndex + 1]);
+        } else {
+            break;
+        }
+        argIndex += 2;
+    }
+    if(argc - argIndex != 6){
+        fprintf(stderr, "You gave %d arguments to the program, \n"
+            "you should run the program with in the form \n"
+            "\t./problem2gen [-s seed] [-w percent] [-u percent] [-r rows] [-l tokens] terms colours tokens table ctt text\n", argc);
+        return EXIT_FAILURE;
+    }
+    g.terms = atoll(argv[argIndex]);
+    g.colours = atoi(argv[argIndex + 1]);
+    g.tokens = atoll(argv[argIndex + 2]);
+    if(g.terms < 1 || g.colours < 1 || g.colours > MAXGENCOLOURS || g.tokens < 0){
+        fprintf(stderr, "Sizes given were %s terms, %s colours and %s tokens, "
+            "which should be at least 1 term, 1 to %d colours and at least 0 tokens\n",
+            argv[argIndex], argv[argIndex + 1], argv[argIndex + 2], MAXGENCOLOURS);
+        return EXIT_FAILURE;
+    }
+    if(g.maxRows < 1){
+        g.maxRows = 1;
+    }
+    if(g.maxRows > g.colours){
+        g.maxRows = g.colours;
+    }
+
+    FILE *tableFile = openOutput(argv[argIndex + 3], "table file");
+    writeTable(tableFile, &g);
+    fclose(tableFile);
+    FILE *transFile = openOutput(argv[argIndex + 4], "transition table file");
+    writeTransitions(transFile, &g);
+    fclose(transFile);
+    FILE *textFile = openOutput(argv[argIndex + 5], "text file");
+    writeText(textFile, &g);
+    fclose(textFile);
+
+    return EXIT_SUCCESS;
+}
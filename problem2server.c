@@ -0,0 +1,834 @@
+/*
+    Make using
+        make problem2server
+
+    Run using
+        ./problem2server socket table [ctt]
+
+        or
+
+        ./problem2server -m model socket
+
+    where socket is the path of the Unix domain socket to
+        listen on, table is the colour table in the expected
+        format (e.g. test_cases/2f-1-table.txt) and ctt is the
+        transition table in the expected format (e.g.
+        test_cases/2f-1-ctt.txt, not needed if only part a is
+        asked for).
+
+    The tables are read once and kept while the server runs,
+    so each text costs only its own solve. Each request is a
+    header line followed by the text, as in
+        f 11\n
+        hello world
+    where the header is the part to solve the text as (a, b,
+    e or f, the default part if left out) and the number of
+    characters of text following it. Each response is the one
+    line problem2<part> would write for the text, or a line
+    starting "error" if the request can't be solved, so part e
+    answers with the score and the others with the colours.
+
+    Requests can be sent one after another without waiting for
+    responses, and are solved on a pool of threads, though the
+    responses to a connection are always written in the order
+    of its requests. A connection which has many requests
+    being solved, or which isn't reading its responses, isn't
+    read from until it catches up.
+
+    problem2client sends texts to the server.
+
+    Options, given before the socket:
+        -p part         part to solve requests which don't give
+                        one as, f by default
+        -o format       write each response as text, colour,
+                        jsonl, binary, binary-spans or html (see
+                        enum outputFormat in problem.h)
+        -t threads      solve on this many threads, by default
+                        one per processor
+        -m model        read the tables from a model file written
+                        by problem2compile, given in place of the
+                        table and ctt
+
+    Sending the process SIGHUP reloads the tables, or the model
+    file, from the same files in the background, as in
+    problem2batch. SIGINT or SIGTERM stops the server: no more
+    requests are taken, but those already taken are solved and
+    their responses written before each connection is closed.
+*/
+/* For accept4. */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "problem.h"
+#include "modelFile.h"
+#include "liveModel.h"
+
+/* Number of events taken from epoll at a time. */
+#define MAXEVENTS 64
+/* Characters read from a connection at a time. */
+#define READSIZE 65536
+/* Longest header line accepted, including its new line. */
+#define MAXHEADER 32
+/* Longest text accepted in a request. */
+#define MAXTEXT (1 << 28)
+/* Requests of a connection being solved or waiting to be written before it isn't read from. */
+#define MAXINFLIGHT 256
+/* Characters of responses a connection can leave unread before it isn't read from. */
+#define MAXUNSENT (1 << 20)
+/* Milliseconds a stopping server waits for a client to take more of its responses. */
+#define STOPWAIT 5000
+
+struct connection;
+
+/* A request and, once solved, its response. */
+struct request {
+    struct connection *c;
+    char part;
+    char *text;
+    int length;
+    char *output;
+    size_t outputLength;
+    /* 1 once output holds the response. */
+    int done;
+    /* The connection's next request, in the order they were sent. */
+    struct request *next;
+    /* The next request in the queue it's waiting in. */
+    struct request *nextQueued;
+};
+
+struct connection {
+    int fd;
+    /* Characters read but not yet taken as requests. */
+    char *in;
+    size_t inLength;
+    size_t inAllocated;
+    /* Requests whose responses haven't been written yet, in order. */
+    struct request *pendingHead;
+    struct request *pendingTail;
+    int pendingCount;
+    /* Responses not yet written to the socket, from outSent on. */
+    char *out;
+    size_t outLength;
+    size_t outAllocated;
+    size_t outSent;
+    /* 1 once the client has sent all it will. */
+    int endOfInput;
+    /* 1 once the client has sent something which isn't a request, so nothing more is taken. */
+    int refused;
+    /* 1 once the socket has failed, so nothing more is written to it. */
+    int failed;
+    /* The events the socket is registered with epoll for. */
+    uint32_t events;
+    /* 1 once closed, waiting to be freed when the events taken with it have been seen. */
+    int closed;
+    /* The next connection waiting to be freed. */
+    struct connection *nextClosed;
+    /* The neighbouring connections in the server's list of those not yet closed. */
+    struct connection *previousOpen;
+    struct connection *nextOpen;
+};
+
+/* A queue of requests shared between threads. */
+struct requestQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    struct request *head;
+    struct request *tail;
+    /* 1 once no more requests will be added. */
+    int stopping;
+};
+
+struct server {
+    struct liveModel *model;
+    char defaultPart;
+    enum outputFormat format;
+    int epollFd;
+    int listenFd;
+    /* Written by workers when they finish a request, to wake the event loop. */
+    int solvedFd;
+    /* Requests waiting for a worker. */
+    struct requestQueue waiting;
+    /* Requests solved but not yet given back to their connection. */
+    struct requestQueue solved;
+    /* Connections closed during the current batch of events. */
+    struct connection *closedConnections;
+    /* Connections not yet closed. */
+    struct connection *openConnections;
+    /* 1 once the server is stopping, so no more requests are taken. */
+    int stopping;
+};
+
+/* Markers for the sockets which aren't connections in epoll's data. */
+static char listenMarker;
+static char solvedMarker;
+
+/* Set when SIGHUP asks for the tables to be reloaded. */
+static volatile sig_atomic_t reloadRequested = 0;
+/* Set when SIGINT or SIGTERM asks the server to stop. */
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestReload(int signalNumber){
+    reloadRequested = 1;
+}
+
+static void requestStop(int signalNumber){
+    stopRequested = 1;
+}
+
+static void initQueue(struct requestQueue *q){
+    pthread_mutex_init(&(q->lock), NULL);
+    pthread_cond_init(&(q->ready), NULL);
+    q->head = NULL;
+    q->tail = NULL;
+    q->stopping = 0;
+}
+
+static void destroyQueue(struct requestQueue *q){
+    pthread_mutex_destroy(&(q->lock));
+    pthread_cond_destroy(&(q->ready));
+}
+
+static void pushQueue(struct requestQueue *q, struct request *r){
+    r->nextQueued = NULL;
+    pthread_mutex_lock(&(q->lock));
+    if(q->tail){
+        q->tail->nextQueued = r;
+    } else {
+        q->head = r;
+    }
+    q->tail = r;
+    pthread_cond_signal(&(q->ready));
+    pthread_mutex_unlock(&(q->lock));
+}
+
+/* Takes every request in the queue, in order, without waiting. */
+static struct request *takeQueue(struct requestQueue *q){
+    pthread_mutex_lock(&(q->lock));
+    struct request *head = q->head;
+    q->head = NULL;
+    q->tail = NULL;
+    pthread_mutex_unlock(&(q->lock));
+    return head;
+}
+
+/* Waits for the next request in the queue, returning NULL once the queue is stopping and empty. */
+static struct request *popQueue(struct requestQueue *q){
+    pthread_mutex_lock(&(q->lock));
+    while(! q->head && ! q->stopping){
+        pthread_cond_wait(&(q->ready), &(q->lock));
+    }
+    struct request *r = q->head;
+    if(r){
+        q->head = r->nextQueued;
+        if(! q->head){
+            q->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&(q->lock));
+    return r;
+}
+
+/* Sets the request's response to the given error line. */
+static void failRequest(struct request *r, const char *message){
+    FILE *output = open_memstream(&(r->output), &(r->outputLength));
+    assert(output);
+    fprintf(output, "error %s\n", message);
+    fclose(output);
+}
+
+/* Solves requests until the server stops. */
+static void *solveRequests(void *arg){
+    struct server *s = (struct server *) arg;
+    struct request *r;
+    while((r = popQueue(&(s->waiting)))){
+        int ticket;
+        struct model *model = acquireLiveModel(s->model, &ticket);
+        if(! modelSupportsPart(model, r->part)){
+            failRequest(r, "part needs a transition table");
+        } else {
+            struct problem *problem = readModelProblem(model, r->text, r->length, r->part);
+            struct solution *solution = solveProblem(problem);
+            FILE *output = open_memstream(&(r->output), &(r->outputLength));
+            assert(output);
+            outputProblemFormat(problem, solution, output, s->format);
+            fclose(output);
+            freeSolution(solution, problem);
+            freeProblem(problem);
+        }
+        releaseLiveModel(s->model, ticket);
+        free(r->text);
+        r->text = NULL;
+        pushQueue(&(s->solved), r);
+        uint64_t one = 1;
+        ssize_t written = write(s->solvedFd, &one, sizeof(one));
+        assert(written == sizeof(one));
+    }
+    return NULL;
+}
+
+/* Adds the request to the end of the connection's pending requests. */
+static struct request *newRequest(struct connection *c, char part){
+    struct request *r = (struct request *) malloc(sizeof(struct request));
+    assert(r);
+    r->c = c;
+    r->part = part;
+    r->text = NULL;
+    r->length = 0;
+    r->output = NULL;
+    r->outputLength = 0;
+    r->done = 0;
+    r->next = NULL;
+    r->nextQueued = NULL;
+    if(c->pendingTail){
+        c->pendingTail->next = r;
+    } else {
+        c->pendingHead = r;
+    }
+    c->pendingTail = r;
+    c->pendingCount++;
+    return r;
+}
+
+static struct connection *newConnection(int fd){
+    struct connection *c = (struct connection *) malloc(sizeof(struct connection));
+    assert(c);
+    c->fd = fd;
+    c->in = NULL;
+    c->inLength = 0;
+    c->inAllocated = 0;
+    c->pendingHead = NULL;
+    c->pendingTail = NULL;
+    c->pendingCount = 0;
+    c->out = NULL;
+    c->outLength = 0;
+    c->outAllocated = 0;
+    c->outSent = 0;
+    c->endOfInput = 0;
+    c->refused = 0;
+    c->failed = 0;
+    c->events = 0;
+    c->closed = 0;
+    c->nextClosed = NULL;
+    c->previousOpen = NULL;
+    c->nextOpen = NULL;
+    return c;
+}
+
+static void freeConnection(struct connection *c){
+    while(c->pendingHead){
+        struct request *r = c->pendingHead;
+        c->pendingHead = r->next;
+        free(r->text);
+        free(r->output);
+        free(r);
+    }
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/* Appends the given characters to the connection's unsent responses. */
+static void appendOutput(struct connection *c, const char *output, size_t length){
+    if(c->outSent == c->outLength){
+        c->outSent = 0;
+        c->outLength = 0;
+    }
+    if(c->outLength + length > c->outAllocated){
+        /* Drop what's been sent before growing. */
+        memmove(c->out, c->out + c->outSent, c->outLength - c->outSent);
+        c->outLength -= c->outSent;
+        c->outSent = 0;
+        if(c->outLength + length > c->outAllocated){
+            c->outAllocated = (c->outLength + length) * 2;
+            c->out = (char *) realloc(c->out, sizeof(char) * c->outAllocated);
+            assert(c->out);
+        }
+    }
+    memcpy(c->out + c->outLength, output, length);
+    c->outLength += length;
+}
+
+/* Moves the responses of solved requests at the front of the connection into its output. */
+static void collectResponses(struct connection *c){
+    while(c->pendingHead && c->pendingHead->done){
+        struct request *r = c->pendingHead;
+        c->pendingHead = r->next;
+        if(! c->pendingHead){
+            c->pendingTail = NULL;
+        }
+        c->pendingCount--;
+        if(! c->failed){
+            appendOutput(c, r->output, r->outputLength);
+        }
+        free(r->output);
+        free(r);
+    }
+}
+
+/*
+    Takes as many whole requests from the characters read as the
+    connection has room for, queueing them to be solved.
+*/
+static void parseRequests(struct server *s, struct connection *c){
+    size_t used = 0;
+    while(! c->refused && c->pendingCount < MAXINFLIGHT){
+        char *header = c->in + used;
+        size_t available = c->inLength - used;
+        char *newLine = (char *) memchr(header, '\n', available < MAXHEADER ? available : MAXHEADER);
+        if(! newLine){
+            if(available >= MAXHEADER){
+                struct request *r = newRequest(c, '\0');
+                failRequest(r, "header is not part and length");
+                r->done = 1;
+                c->refused = 1;
+            }
+            break;
+        }
+        char part = s->defaultPart;
+        char *number = header;
+        if(isalpha((unsigned char) *number)){
+            part = (char) toupper((unsigned char) *number);
+            number++;
+            while(*number == ' '){
+                number++;
+            }
+        }
+        char *end;
+        long length = strtol(number, &end, 10);
+        if(end == number || length < 0 || length > MAXTEXT || (*end != '\n' && *end != '\r')
+            || (part != 'A' && part != 'B' && part != 'E' && part != 'F')){
+            /* The rest of the input can't be found the start of, so no more requests are taken. */
+            struct request *r = newRequest(c, part);
+            failRequest(r, "header is not part and length");
+            r->done = 1;
+            c->refused = 1;
+            break;
+        }
+        size_t headerLength = (size_t) (newLine - header) + 1;
+        if(available - headerLength < (size_t) length){
+            break;
+        }
+        struct request *r = newRequest(c, part);
+        r->length = (int) length;
+        r->text = (char *) malloc(sizeof(char) * (length + 1));
+        assert(r->text);
+        memcpy(r->text, header + headerLength, length);
+        used += headerLength + length;
+        pushQueue(&(s->waiting), r);
+    }
+    if(c->refused){
+        c->inLength = 0;
+    } else if(used > 0){
+        memmove(c->in, c->in + used, c->inLength - used);
+        c->inLength -= used;
+    }
+    collectResponses(c);
+}
+
+/* Writes as much unsent output as the socket will take without blocking. */
+static void writeOutput(struct connection *c){
+    while(! c->failed && c->outSent < c->outLength){
+        ssize_t written = send(c->fd, c->out + c->outSent, c->outLength - c->outSent, MSG_NOSIGNAL);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            if(errno != EAGAIN && errno != EWOULDBLOCK){
+                c->failed = 1;
+            }
+            return;
+        }
+        c->outSent += (size_t) written;
+    }
+}
+
+/* Reads what the socket has without blocking. */
+static void readInput(struct connection *c){
+    if(c->inAllocated - c->inLength < READSIZE){
+        c->inAllocated = c->inLength + READSIZE * 2;
+        c->in = (char *) realloc(c->in, sizeof(char) * c->inAllocated);
+        assert(c->in);
+    }
+    ssize_t got = recv(c->fd, c->in + c->inLength, READSIZE, 0);
+    if(got > 0){
+        c->inLength += (size_t) got;
+    } else if(got == 0){
+        c->endOfInput = 1;
+    } else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+        c->failed = 1;
+    }
+}
+
+/*
+    Registers the connection for the events it can act on now, or
+    closes it once nothing is left to do for it. A connection is only
+    read from while it has room for more requests and its client is
+    reading its responses. Returns 0 if the connection was closed.
+    Closed connections are only freed by freeClosedConnections, as
+    events for them can still be waiting in the batch being handled.
+*/
+static int updateConnection(struct server *s, struct connection *c){
+    if(c->closed){
+        return 0;
+    }
+    int unsent = ! c->failed && c->outSent < c->outLength;
+    if(c->failed || ((c->endOfInput || c->refused) && ! unsent && ! c->pendingHead)){
+        /* Requests being solved still point at the connection, so it's kept until they finish. */
+        if(c->fd >= 0){
+            epoll_ctl(s->epollFd, EPOLL_CTL_DEL, c->fd, NULL);
+            close(c->fd);
+            c->fd = -1;
+        }
+        if(! c->pendingHead){
+            c->closed = 1;
+            if(c->previousOpen){
+                c->previousOpen->nextOpen = c->nextOpen;
+            } else {
+                s->openConnections = c->nextOpen;
+            }
+            if(c->nextOpen){
+                c->nextOpen->previousOpen = c->previousOpen;
+            }
+            c->nextClosed = s->closedConnections;
+            s->closedConnections = c;
+            return 0;
+        }
+        return 1;
+    }
+    uint32_t events = 0;
+    if(! c->endOfInput && ! c->refused && c->pendingCount < MAXINFLIGHT
+        && c->outLength - c->outSent < MAXUNSENT){
+        events |= EPOLLIN;
+    }
+    if(unsent){
+        events |= EPOLLOUT;
+    }
+    if(events != c->events){
+        struct epoll_event event;
+        event.events = events;
+        event.data.ptr = c;
+        epoll_ctl(s->epollFd, EPOLL_CTL_MOD, c->fd, &event);
+        c->events = events;
+    }
+    return 1;
+}
+
+/* Frees the connections closed while handling the last batch of events. */
+static void freeClosedConnections(struct server *s){
+    while(s->closedConnections){
+        struct connection *c = s->closedConnections;
+        s->closedConnections = c->nextClosed;
+        freeConnection(c);
+    }
+}
+
+/* Accepts every connection waiting on the listening socket. */
+static void acceptConnections(struct server *s){
+    int fd;
+    while((fd = accept4(s->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0){
+        struct connection *c = newConnection(fd);
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = c;
+        if(epoll_ctl(s->epollFd, EPOLL_CTL_ADD, fd, &event) < 0){
+            close(fd);
+            freeConnection(c);
+            continue;
+        }
+        c->events = EPOLLIN;
+        c->nextOpen = s->openConnections;
+        if(c->nextOpen){
+            c->nextOpen->previousOpen = c;
+        }
+        s->openConnections = c;
+    }
+}
+
+/* Gives solved requests back to their connections, writing what can now be written. */
+static void finishRequests(struct server *s){
+    uint64_t count;
+    ssize_t got = read(s->solvedFd, &count, sizeof(count));
+    (void) got;
+    struct request *r = takeQueue(&(s->solved));
+    while(r){
+        struct request *next = r->nextQueued;
+        struct connection *c = r->c;
+        r->done = 1;
+        if(c->pendingHead == r){
+            /* Only look at the connection once for its run of solved requests. */
+            collectResponses(c);
+            if(! c->failed && ! s->stopping){
+                /* Requests held back while the connection had no room can be taken now. */
+                parseRequests(s, c);
+                writeOutput(c);
+            }
+            updateConnection(s, c);
+        }
+        r = next;
+    }
+}
+
+/* Acts on an event for a connection. */
+static void serveConnection(struct server *s, struct connection *c, uint32_t events){
+    if(c->closed || c->fd < 0){
+        /* Closed earlier in the same batch of events. */
+        return;
+    }
+    if(events & (EPOLLERR | EPOLLHUP)){
+        /* The client may have left responses unread, but has gone. */
+        if(! (events & EPOLLIN)){
+            c->failed = 1;
+        }
+    }
+    if((events & EPOLLIN) && (c->events & EPOLLIN)){
+        readInput(c);
+        parseRequests(s, c);
+    }
+    if(! c->failed){
+        writeOutput(c);
+    }
+    updateConnection(s, c);
+}
+
+/*
+    Writes what's left of each connection's responses, waiting up to
+    STOPWAIT milliseconds at a time for its client to read them, then
+    closes and frees every connection. Only used once the workers have
+    finished and their requests have been given back.
+*/
+static void closeConnections(struct server *s){
+    while(s->openConnections){
+        struct connection *c = s->openConnections;
+        s->openConnections = c->nextOpen;
+        if(c->fd >= 0){
+            writeOutput(c);
+            while(! c->failed && c->outSent < c->outLength){
+                struct pollfd writable = { c->fd, POLLOUT, 0 };
+                int ready = poll(&writable, 1, STOPWAIT);
+                if(ready == 0 || (ready < 0 && errno != EINTR)){
+                    break;
+                }
+                writeOutput(c);
+            }
+            close(c->fd);
+        }
+        freeConnection(c);
+    }
+}
+
+static int listenOn(const char *path){
+    struct sockaddr_un address;
+    if(strlen(path) >= sizeof(address.sun_path)){
+        fprintf(stderr, "Socket path given was \"%s\", which is too long for a socket\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0){
+        perror("Reason for socket failure");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    /* A socket left by an earlier server would stop the bind. */
+    unlink(path);
+    if(bind(fd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0){
+        fprintf(stderr, "Socket given was \"%s\", which was unable to be listened on\n", path);
+        perror("Reason for socket failure");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char **argv){
+    enum outputFormat format = OUTPUT_TEXT;
+    char defaultPart = 'F';
+    int threadCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int argIndex = 1;
+    /* Precompiled model file given in place of the tables, if any. */
+    const char *modelPath = NULL;
+
+    while(argIndex < argc && argv[argIndex][0] == '-'){
+        if(argv[argIndex][1] == 'p' && argIndex + 1 < argc){
+            defaultPart = (char) toupper((unsigned char) argv[argIndex + 1][0]);
+            argIndex++;
+        } else if(argv[argIndex][1] == 'o' && argIndex + 1 < argc){
+            if(findOutputFormat(argv[argIndex + 1]) < 0){
+                fprintf(stderr, "Output format given was \"%s\", which is not one of "
+                    "text, colour, jsonl, binary, binary-spans or html\n", argv[argIndex + 1]);
+                return EXIT_FAILURE;
+            }
+            format = (enum outputFormat) findOutputFormat(argv[argIndex + 1]);
+            argIndex++;
+        } else if(argv[argIndex][1] == 'm' && argIndex + 1 < argc){
+            modelPath = argv[argIndex + 1];
+            argIndex++;
+        } else if(argv[argIndex][1] == 't' && argIndex + 1 < argc){
+            threadCount = atoi(argv[argIndex + 1]);
+            argIndex++;
+        } else {
+            break;
+        }
+        argIndex++;
+    }
+    if(threadCount < 1){
+        threadCount = 1;
+    }
+
+    int fileCount = modelPath ? 0 : 1;
+    if(argIndex + fileCount >= argc || (defaultPart != 'A' && defaultPart != 'B'
+        && defaultPart != 'E' && defaultPart != 'F')){
+        fprintf(stderr, "You only gave %d arguments to the program, \n"
+            "you should run the program with in the form \n"
+            "\t./problem2server [-p part] [-o format] [-t threads] [-m model] socket [wordtable [transitiontable]]\n", argc);
+        return EXIT_FAILURE;
+    }
+    const char *socketPath = argv[argIndex];
+    const char *tablePath = modelPath ? NULL : argv[argIndex + 1];
+    const char *transPath = (! modelPath && argIndex + 2 < argc) ? argv[argIndex + 2] : NULL;
+
+    struct model *model;
+    if(modelPath){
+        FILE *modelFile = fopen(modelPath, "rb");
+        if(! modelFile){
+            fprintf(stderr, "File given as model file was \"%s\", which was unable to be opened\n", modelPath);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+        model = mapModel(modelFile);
+        fclose(modelFile);
+        if(! model){
+            fprintf(stderr, "File given as model file was \"%s\", which is not a model file from problem2compile\n", modelPath);
+            return EXIT_FAILURE;
+        }
+    } else {
+        FILE *tableFile = fopen(tablePath, "r");
+        if(! tableFile){
+            fprintf(stderr, "File given as table file was \"%s\", which was unable to be opened\n", tablePath);
+            perror("Reason for file open failure");
+            return EXIT_FAILURE;
+        }
+        FILE *transFile = NULL;
+        if(transPath){
+            transFile = fopen(transPath, "r");
+            if(! transFile){
+                fprintf(stderr, "File given as transition table file was \"%s\", which was unable to be opened\n", transPath);
+                perror("Reason for file open failure");
+                return EXIT_FAILURE;
+            }
+        }
+        model = readModel(tableFile, transFile);
+        fclose(tableFile);
+        if(transFile){
+            fclose(transFile);
+        }
+        if(! model){
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct server s;
+    s.model = newLiveModel(model);
+    s.defaultPart = defaultPart;
+    s.format = format;
+    s.closedConnections = NULL;
+    s.openConnections = NULL;
+    s.stopping = 0;
+    initQueue(&(s.waiting));
+    initQueue(&(s.solved));
+    s.listenFd = listenOn(socketPath);
+    if(s.listenFd < 0){
+        return EXIT_FAILURE;
+    }
+    s.solvedFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    s.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    assert(s.solvedFd >= 0 && s.epollFd >= 0);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &listenMarker;
+    epoll_ctl(s.epollFd, EPOLL_CTL_ADD, s.listenFd, &event);
+    event.events = EPOLLIN;
+    event.data.ptr = &solvedMarker;
+    epoll_ctl(s.epollFd, EPOLL_CTL_ADD, s.solvedFd, &event);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    /* No SA_RESTART, so the event loop wakes to act on the signal. */
+    action.sa_handler = requestReload;
+    sigaction(SIGHUP, &action, NULL);
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    /* Clients which go away are seen as failed sends instead. */
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_t *threads = (pthread_t *) malloc(sizeof(pthread_t) * threadCount);
+    assert(threads);
+    int started = 0;
+    for(int i = 0; i < threadCount; i++){
+        if(pthread_create(&threads[started], NULL, solveRequests, &s) == 0){
+            started++;
+        }
+    }
+    if(started == 0){
+        fprintf(stderr, "No threads could be started to solve requests\n");
+        return EXIT_FAILURE;
+    }
+
+    struct epoll_event events[MAXEVENTS];
+    while(! stopRequested){
+        int count = epoll_wait(s.epollFd, events, MAXEVENTS, -1);
+        if(reloadRequested){
+            reloadRequested = 0;
+            reloadLiveModel(s.model, tablePath, transPath, modelPath);
+        }
+        for(int i = 0; i < count; i++){
+            if(events[i].data.ptr == &listenMarker){
+                acceptConnections(&s);
+            } else if(events[i].data.ptr == &solvedMarker){
+                finishRequests(&s);
+            } else {
+                serveConnection(&s, (struct connection *) events[i].data.ptr, events[i].events);
+            }
+        }
+        freeClosedConnections(&s);
+    }
+
+    /* Requests still waiting are solved before the workers finish. */
+    s.stopping = 1;
+    pthread_mutex_lock(&(s.waiting.lock));
+    s.waiting.stopping = 1;
+    pthread_cond_broadcast(&(s.waiting.ready));
+    pthread_mutex_unlock(&(s.waiting.lock));
+    for(int i = 0; i < started; i++){
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    /* Every request taken has now been solved, so each connection's responses can be written out. */
+    finishRequests(&s);
+    freeClosedConnections(&s);
+    closeConnections(&s);
+    close(s.listenFd);
+    unlink(socketPath);
+    close(s.solvedFd);
+    close(s.epollFd);
+    destroyQueue(&(s.waiting));
+    destroyQueue(&(s.solved));
+    freeLiveModel(s.model);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/*
+    Header for the parts of the Problem 2 module shared with the
+        solvers built on top of it, which aren't part of its
+        interface for the drivers. Modules using these also
+        include problemStruct.c for the structs themselves.
+*/
+#include <stdio.h>
+#include "problem.h"
+
+#ifndef PROBLEMINTERNAL_H
+#define PROBLEMINTERNAL_H
+
+struct termSpan;
+
+/* -1 to show the colour hasn't been set. */
+#define DEFAULTCOLOUR (-1)
+/* -1 to be lower than zero to highlight in case accidentally used. */
+#define DEFAULTSCORE (-1)
+
+/* No colour is assigned where no highlighting rules are present. */
+#define NO_COLOUR (0)
+
+/* Sets up a problem with no text or model. */
+struct problem *newProblem();
+
+/* Sets up a model with no term colour tables or transition table. */
+struct model *newModel();
+
+/* Sets up a solution for the given problem. */
+struct solution *newSolution(struct problem *problem);
+
+/*
+    Finds the next term in the length characters of text given, greedily
+    matching the longest term in the term colour tables. Returns how many
+    characters were consumed and sets *term to where the term is in the 
+    text and its table index (or TERMHASH_NOT_FOUND). The term's length is
+    0 if only punctuation was consumed. Unless final is set, a term which 
+    could continue past the text given is left unconsumed for a later call.
+    A word running to the end of the text given which is already longer
+    than any term can't be one, so is consumed as a term without a table
+    straight away; the caller must skip the rest of the word, up to the
+    next whitespace, in the text which follows.
+*/
+int nextTerm(struct problem *p, const char *text, int length, int final,
+    struct termSpan *term);
+
+/* 
+    Returns the scores of every colour for the given term, indexed by
+    colour. Colours without a score hold DEFAULTSCORE.
+*/
+int *getWCRow(struct problem *p, int term);
+
+/* As getWCRow, for the given table index or TERMHASH_NOT_FOUND. */
+int *getTableWCRow(struct problem *p, int table);
+
+/* 
+    Finds the colour with the best score in the given DP column, or 
+    DEFAULTCOLOUR if no colour scores above DEFAULTSCORE.
+*/
+int bestDPColour(struct problem *p, const int *column);
+
+#endif
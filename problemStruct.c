@@ -6,16 +6,27 @@
         in storing the problem and its
         information.
 */
+#ifndef PROBLEMSTRUCT_C
+#define PROBLEMSTRUCT_C
+#include <stdint.h>
+#include <stddef.h>
 
 struct termColourTable;
 
 struct colourTransitionTable;
 
+struct model;
+
+struct termSpan;
+
+struct arena;
+
 struct termColourTable {
     /* The term the table is for. */
     char *term;
     /* The number of colours in the table including 
-        no colour. */
+        no colour. Once the problem is read, this is the
+        colour count of the problem. */
     int colourCount;
     /* The colours. */
     int *colours;
@@ -32,6 +43,34 @@ struct colourTransitionTable {
     int *colours;
     /* The score for each colour transition. */
     int *scores;
+
+    /* 
+        The table compiled into a dense matrix, with the score
+        for prevColour -> colour at [prevColour * matrixColours + colour].
+        Transitions not given in the table hold DEFAULTSCORE. Allocated
+        aligned to a cache line.
+    */
+    int matrixColours;
+    int *matrix;
+    /* 
+        Bitmask of which transitions were given in the table, with 
+        allowedWords words per preceeding colour.
+    */
+    int allowedWords;
+    uint64_t *allowed;
+};
+
+struct termSpan {
+    /* Where the term starts in the text. */
+    int start;
+    /* The number of characters in the term. */
+    int length;
+    /* 
+        The index of the term colour table for the term, or 
+        TERMHASH_NOT_FOUND if the term has no table. Resolved 
+        once during tokenizing.
+    */
+    int table;
 };
 
 #ifndef PROBLEMPARTENUM_DEF
@@ -44,37 +83,72 @@ enum problemPart {
 };
 #endif
 
+/*
+    The term colour tables and colour transition table, along with the
+    indices over them. Only read from once built, so any number of
+    problems can share one, on any number of threads.
+*/
+struct model {
+    /* Part A onwards. */
+    /* The number of term colour tables. */
+    int termColourTableCount;
+    /* The term colour tables, one for each term. */
+    struct termColourTable *colourTables;
+    /* 
+        The number of colours, one more than the highest colour
+        in the term colour tables or colour transition table. Every
+        term colour table has a score for each colour.
+    */
+    int colourCount;
+    /* Scores for terms without a table, DEFAULTSCORE for every colour. */
+    int *noScores;
+    /* Hash index over the terms of the colour tables. */
+    struct termHash *termIndex;
+    /* Case-folded trie of the terms, for greedy matching. */
+    struct termTrie *termTrie;
+    /* Length of the longest term in the colour tables. */
+    int maxTermLength;
+
+    /* Part B onwards. */
+    /* 
+        The colour transition table, describing the cost 
+        of transitions between colours.
+    */
+    struct colourTransitionTable *colourTransitionTable;
+
+    /* 
+        The model file mapped for the model, or NULL if the model was
+        read from the tables. The term colour tables' terms, colours and
+        scores and the transition table's arrays then point into it.
+    */
+    void *mapping;
+    size_t mappingSize;
+};
+
 struct problem {
     /* The number of terms in the text. */
     int termCount;
     /* The original text. */
     char *text;
     /* 
-        The term broken into tokens. These will
-        be fresh strings if the they are not
-        in the term colour table, if they are
-        in the term colour table, they will be
-        stored at the same place in memory so
-        terms in the term table can be compared 
-        using either strcmp or equality.
+        The text broken into terms, each a span of
+        the text along with its term colour table.
     */
-    char **terms;
+    struct termSpan *terms;
 
     /* Which problem part is being solved. */
     enum problemPart part;
 
-    /* Part A onwards. */
-    /* The number of term colour tables. */
-    int termColourTableCount;
-    /* The term colour tables, one for each term. */
-    struct termColourTable *colourTables;
+    /* The tables the text is solved against. */
+    struct model *model;
+    /* Whether the model was read for this problem and is freed with it. */
+    int ownsModel;
 
-    /* Part B onwards. */
     /* 
-        The colour transition table, describing the cost 
-        of transitions between colours.
+        Arena holding the text, terms, solutions and solver buffers,
+        all released together when the problem is freed.
     */
-    struct colourTransitionTable *colourTransitionTable;
+    struct arena *arena;
 };
 
-
+#endif
@@ -9,6 +9,8 @@
     You may change this file if you would
         like to add additional fields.
 */
+#ifndef SOLUTIONSTRUCT_C
+#define SOLUTIONSTRUCT_C
 struct solution {
     /* The number of terms in the problem. */
     int termCount;
@@ -17,3 +19,5 @@ struct solution {
     /* The total score for the sentence. */
     int score;
 };
+
+#endif
@@ -0,0 +1,306 @@
+/*
+    Implementation for module which decodes a stream of text as
+        in Part F, one term at a time.
+
+    The DP advances one column per term, keeping backpointers for
+        only the terms whose colours haven't been written yet in a
+        ring. After each term, the paths back from every colour the
+        term can still take are followed until they meet. Every term
+        up to where they meet has the same colour on all of them, so
+        it can't change and is written. Colours written this way, or
+        because of the maximum lag, stand even if a later term leaves
+        no colouring with a score, so the output differs from Part F's
+        there, where every colour is -1.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include "problemInternal.h"
+#include "termHash.h"
+#include "maxPlus.h"
+#include "problemStruct.c"
+#include "outputBuffer.h"
+#include "stream.h"
+
+/* Number of characters of text to allocate space for initially. */
+#define INITIALBUFFER 4096
+
+struct streamDecoder {
+    struct problem *p;
+    int colourCount;
+    FILE *out;
+    /* Colours are formatted here, and written out once known. */
+    struct outputBuffer output;
+
+    /* Text fed but not yet split into terms. */
+    char *buffer;
+    int bufferLength;
+    int bufferAllocated;
+    /* 1 while skipping the rest of a word already decoded as a term without a table. */
+    int skippingWord;
+
+    /* DP columns of the latest term and the one before it. */
+    int *column;
+    int *prevColumn;
+    /* The argmax of each colour from the kernel. */
+    int *from;
+
+    /* The number of terms decoded so far. */
+    long termCount;
+    /* The number of terms whose colour has been written. */
+    long written;
+
+    /* Backpointers of the latest ringSize terms, term i at slot i % ringSize. */
+    int ringSize;
+    uint16_t *ring;
+
+    /* Colours on the paths being followed back. */
+    int *states;
+    /* Marks colours already in states, marked when equal to stamp. */
+    int *marks;
+    int stamp;
+    /* Colours of the terms being written. */
+    int *path;
+};
+
+struct streamDecoder *newStreamDecoder(struct problem *p, int maxLag, FILE *out){
+    assert(maxLag > 0);
+    assert(p->model->colourCount <= UINT16_MAX + 1);
+    struct streamDecoder *d = (struct streamDecoder *) malloc(sizeof(struct streamDecoder));
+    assert(d);
+    d->p = p;
+    d->colourCount = p->model->colourCount;
+    d->out = out;
+    newOutputBuffer(&(d->output), out);
+
+    d->buffer = (char *) malloc(sizeof(char) * INITIALBUFFER);
+    assert(d->buffer);
+    d->bufferLength = 0;
+    d->bufferAllocated = INITIALBUFFER;
+    d->skippingWord = 0;
+
+    d->column = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->column);
+    d->prevColumn = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->prevColumn);
+    d->from = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->from);
+
+    d->termCount = 0;
+    d->written = 0;
+
+    d->ringSize = maxLag + 1;
+    d->ring = (uint16_t *) malloc(sizeof(uint16_t) * d->ringSize * d->colourCount);
+    assert(d->ring);
+
+    d->states = (int *) malloc(sizeof(int) * d->colourCount);
+    assert(d->states);
+    d->marks = (int *) calloc(d->colourCount, sizeof(int));
+    assert(d->marks);
+    d->stamp = 0;
+    d->path = (int *) malloc(sizeof(int) * d->ringSize);
+    assert(d->path);
+    return d;
+}
+
+/* Writes the colour of the next term. */
+static void writeColour(struct streamDecoder *d, int colour){
+    if(d->written != 0){
+        outputBufferChar(&(d->output), ' ');
+    }
+    outputBufferInt(&(d->output), colour);
+    d->written++;
+}
+
+/* Follows the path to term `from` coloured colour back to the colour of term `to`. */
+static int traceBack(struct streamDecoder *d, long from, int colour, long to){
+    for(long t = from; t > to; t--){
+        colour = d->ring[(t % d->ringSize) * d->colourCount + colour];
+    }
+    return colour;
+}
+
+/* Writes the colours of every unwritten term up to term last, which is coloured colour. */
+static void writePath(struct streamDecoder *d, long last, int colour){
+    long first = d->written;
+    d->path[last - first] = colour;
+    for(long t = last; t > first; t--){
+        d->path[t - 1 - first] = d->ring[(t % d->ringSize) * d->colourCount + d->path[t - first]];
+    }
+    for(long t = first; t <= last; t++){
+        writeColour(d, d->path[t - first]);
+    }
+}
+
+/* Writes the colours of every term all remaining paths agree on. */
+static void writeConverged(struct streamDecoder *d){
+    long last = d->termCount - 1;
+    long written = d->written;
+    int stateCount = 0;
+    for(int c = 0; c < d->colourCount; c++){
+        if(d->column[c] != MAXPLUS_UNREACHABLE){
+            d->states[stateCount] = c;
+            stateCount++;
+        }
+    }
+    if(stateCount == 0){
+        /*
+            No colouring scores, and none can from here on. Colours
+            already written stand, though solveProblemF would give
+            DEFAULTCOLOUR for every term.
+        */
+        while(d->written <= last){
+            writeColour(d, DEFAULTCOLOUR);
+        }
+        fflush(d->out);
+        return;
+    }
+
+    /* Step every path back together until they meet. */
+    long t = last;
+    while(stateCount > 1 && t > written){
+        uint16_t *from = d->ring + (t % d->ringSize) * d->colourCount;
+        int nextCount = 0;
+        if(d->stamp == INT_MAX){
+            memset(d->marks, 0, sizeof(int) * d->colourCount);
+            d->stamp = 0;
+        }
+        d->stamp++;
+        for(int k = 0; k < stateCount; k++){
+            int c = from[d->states[k]];
+            if(d->marks[c] != d->stamp){
+                d->marks[c] = d->stamp;
+                d->states[nextCount] = c;
+                nextCount++;
+            }
+        }
+        stateCount = nextCount;
+        t--;
+    }
+
+    if(stateCount == 1){
+        writePath(d, t, d->states[0]);
+    } else if(last - written >= d->ringSize - 1){
+        /*
+            Paths haven't met within the maximum lag, so commit the oldest
+            term to its colour on the current best path, and drop every
+            path which disagrees.
+        */
+        int colour = traceBack(d, last, bestDPColour(d->p, d->column), written);
+        writeColour(d, colour);
+        for(int c = 0; c < d->colourCount; c++){
+            if(d->column[c] != MAXPLUS_UNREACHABLE && traceBack(d, last, c, written) != colour){
+                d->column[c] = MAXPLUS_UNREACHABLE;
+            }
+        }
+    }
+    if(d->written != written){
+        outputBufferFlush(&(d->output));
+        fflush(d->out);
+    }
+}
+
+/* Advances the DP over a term with the given table index. */
+static void addTerm(struct streamDecoder *d, int table){
+    int *wc = getTableWCRow(d->p, table);
+    if(d->termCount == 0){
+        for(int c = 0; c < d->colourCount; c++){
+            d->column[c] = (wc[c] == DEFAULTSCORE) ? MAXPLUS_UNREACHABLE : wc[c];
+        }
+    } else {
+        int *swap = d->prevColumn;
+        d->prevColumn = d->column;
+        d->column = swap;
+        maxPlusStepArgmax(d->prevColumn, d->p->model->colourTransitionTable->matrix, wc,
+            d->column, d->from, d->colourCount);
+        uint16_t *entries = d->ring + (d->termCount % d->ringSize) * d->colourCount;
+        for(int c = 0; c < d->colourCount; c++){
+            entries[c] = (uint16_t) d->from[c];
+        }
+    }
+    d->termCount++;
+    writeConverged(d);
+}
+
+/* Splits as much of the buffered text into terms as can be, decoding each. */
+static void decodeBuffer(struct streamDecoder *d, int final){
+    int progress = 0;
+    while(progress < d->bufferLength){
+        if(d->skippingWord){
+            /* The word was too long to be a term, so the rest of it needn't be kept. */
+            while(progress < d->bufferLength && d->buffer[progress] != '\0' &&
+                ! isspace((unsigned char) d->buffer[progress])){
+                progress++;
+            }
+            if(progress == d->bufferLength){
+                break;
+            }
+            d->skippingWord = 0;
+        }
+        struct termSpan term;
+        int remaining = d->bufferLength - progress;
+        int consumed = nextTerm(d->p, d->buffer + progress, remaining, final, &term);
+        if(consumed == 0){
+            break;
+        }
+        progress += consumed;
+        if(term.length == 0){
+            continue;
+        }
+        if(! final && term.start + term.length == remaining){
+            /* A word too long to be a term reached the end of the text so far. */
+            d->skippingWord = 1;
+        }
+        addTerm(d, term.table);
+    }
+    memmove(d->buffer, d->buffer + progress, d->bufferLength - progress);
+    d->bufferLength -= progress;
+}
+
+void streamDecoderFeed(struct streamDecoder *d, const char *text, int length){
+    if(d->bufferLength + length > d->bufferAllocated){
+        while(d->bufferLength + length > d->bufferAllocated){
+            d->bufferAllocated = d->bufferAllocated * 2;
+        }
+        d->buffer = (char *) realloc(d->buffer, sizeof(char) * d->bufferAllocated);
+        assert(d->buffer);
+    }
+    memcpy(d->buffer + d->bufferLength, text, length);
+    d->bufferLength += length;
+    decodeBuffer(d, 0);
+}
+
+void streamDecoderFinish(struct streamDecoder *d){
+    decodeBuffer(d, 1);
+    if(d->written < d->termCount){
+        int colour = bestDPColour(d->p, d->column);
+        if(colour == DEFAULTCOLOUR){
+            while(d->written < d->termCount){
+                writeColour(d, DEFAULTCOLOUR);
+            }
+        } else {
+            writePath(d, d->termCount - 1, colour);
+        }
+    }
+    outputBufferChar(&(d->output), '\n');
+    outputBufferFlush(&(d->output));
+    fflush(d->out);
+}
+
+void freeStreamDecoder(struct streamDecoder *d){
+    if(d){
+        free(d->buffer);
+        free(d->column);
+        free(d->prevColumn);
+        free(d->from);
+        free(d->ring);
+        free(d->states);
+        free(d->marks);
+        free(d->path);
+        free(d);
+    }
+}
@@ -0,0 +1,35 @@
+/*
+    Header for module which decodes a stream of text as in
+        Part F, one term at a time, writing each term's colour
+        as soon as it can no longer change.
+*/
+#include <stdio.h>
+
+struct streamDecoder;
+
+/* Maximum lag used when none is given. */
+#define STREAM_DEFAULT_MAX_LAG 256
+
+/*
+    Sets up a decoder for text decoded against the tables of the given
+    problem (from readStreamProblem), writing colours to out. A term's 
+    colour is written once every path still able to be the best agrees 
+    on it, or once maxLag terms follow it, whichever comes first. Colours
+    written because of maxLag are committed to, so can differ from the
+    colours solveProblemF would give. Likewise, if a later term leaves no
+    colouring with a score, colours already written stand and the rest
+    are DEFAULTCOLOUR, where solveProblemF gives DEFAULTCOLOUR for all.
+*/
+struct streamDecoder *newStreamDecoder(struct problem *p, int maxLag, FILE *out);
+
+/* Feeds the next length characters of text to the decoder. */
+void streamDecoderFeed(struct streamDecoder *d, const char *text, int length);
+
+/* 
+    Marks the end of the text, writing the colours of every remaining
+    term followed by a newline.
+*/
+void streamDecoderFinish(struct streamDecoder *d);
+
+/* Frees the given decoder and all memory allocated for it. */
+void freeStreamDecoder(struct streamDecoder *d);
@@ -0,0 +1,178 @@
+/*
+    Implementation for module which parses the rows of the table
+        files.
+
+    Rows are one to a line, with fields separated by commas and
+        optional spaces or tabs around the numbers. Blank lines
+        between rows are skipped. Terms run up to the first comma
+        on their line, found with memchr, and numbers are read a
+        digit at a time, so no character is looked at twice and
+        the locale plays no part.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "tableParse.h"
+
+void newTableParser(struct tableParser *tp, const char *source, const char *text,
+    size_t length){
+    tp->source = source;
+    tp->text = text;
+    tp->length = length;
+    tp->position = 0;
+    tp->line = 1;
+    tp->lineStart = 0;
+    tp->failed = 0;
+}
+
+/*
+    Reports that what was expected at the given position wasn't there.
+    Only the first error is reported, and the parser takes nothing more
+    once it has failed.
+*/
+static void parseError(struct tableParser *tp, size_t position, const char *expected){
+    if(! tp->failed){
+        fprintf(stderr, "Error in %s at line %d, column %d: expected %s\n", tp->source,
+            tp->line, (int) (position - tp->lineStart) + 1, expected);
+    }
+    tp->failed = 1;
+}
+
+/* Skips whitespace, including whole blank lines. */
+static void skipLines(struct tableParser *tp){
+    while(tp->position < tp->length){
+        char c = tp->text[tp->position];
+        if(c == '\n'){
+            tp->line++;
+            tp->lineStart = tp->position + 1;
+        } else if(c != ' ' && c != '\t' && c != '\r' && c != '\v' && c != '\f'){
+            return;
+        }
+        tp->position++;
+    }
+}
+
+/* Skips whitespace within the current line. */
+static void skipBlanks(struct tableParser *tp){
+    while(tp->position < tp->length && (tp->text[tp->position] == ' ' ||
+        tp->text[tp->position] == '\t' || tp->text[tp->position] == '\r')){
+        tp->position++;
+    }
+}
+
+/* Parses the comma before the next field. */
+static void parseComma(struct tableParser *tp){
+    skipBlanks(tp);
+    if(tp->position >= tp->length || tp->text[tp->position] != ','){
+        parseError(tp, tp->position, "','");
+    }
+    tp->position++;
+}
+
+/* Parses a decimal integer which fits in an int. */
+static int parseInt(struct tableParser *tp, const char *what){
+    skipBlanks(tp);
+    size_t start = tp->position;
+    int negative = 0;
+    if(tp->position < tp->length && (tp->text[tp->position] == '-' || tp->text[tp->position] == '+')){
+        negative = (tp->text[tp->position] == '-');
+        tp->position++;
+    }
+    /* Kept positive, with one more allowed for INT_MIN. */
+    long long limit = negative ? -(long long) INT_MIN : INT_MAX;
+    long long value = 0;
+    size_t digitStart = tp->position;
+    while(tp->position < tp->length && tp->text[tp->position] >= '0' && tp->text[tp->position] <= '9'){
+        value = value * 10 + (tp->text[tp->position] - '0');
+        if(value > limit){
+            parseError(tp, start, "a number that fits in an int");
+            return 0;
+        }
+        tp->position++;
+    }
+    if(tp->position == digitStart){
+        parseError(tp, start, what);
+        return 0;
+    }
+    return (int) (negative ? -value : value);
+}
+
+/*
+    Parses a colour, which can't be past MAXCOLOURS - 1, nor below
+    lowest.
+*/
+static int parseColour(struct tableParser *tp, const char *what, int lowest){
+    skipBlanks(tp);
+    size_t start = tp->position;
+    int colour = parseInt(tp, what);
+    if(colour < lowest || colour >= MAXCOLOURS){
+        char expected[64];
+        if(lowest == 0){
+            sprintf(expected, "%s from 0 to %d", what, MAXCOLOURS - 1);
+        } else {
+            sprintf(expected, "%s of at most %d", what, MAXCOLOURS - 1);
+        }
+        parseError(tp, start, expected);
+    }
+    return colour;
+}
+
+/* Parses the end of the row, leaving the parser at the start of the next. */
+static void parseRowEnd(struct tableParser *tp){
+    skipBlanks(tp);
+    if(tp->position < tp->length && tp->text[tp->position] != '\n'){
+        parseError(tp, tp->position, "end of line");
+    }
+    skipLines(tp);
+}
+
+int parseTableRow(struct tableParser *tp, const char **term, int *termLength,
+    int *colour, int *score){
+    if(tp->failed){
+        return -1;
+    }
+    skipLines(tp);
+    if(tp->position >= tp->length){
+        return 0;
+    }
+    size_t start = tp->position;
+    const char *lineEnd = memchr(tp->text + start, '\n', tp->length - start);
+    size_t lineLength = lineEnd ? (size_t) (lineEnd - (tp->text + start)) : tp->length - start;
+    const char *comma = memchr(tp->text + start, ',', lineLength);
+    if(! comma){
+        parseError(tp, start + lineLength, "',' after the term");
+        return -1;
+    }
+    if(comma == tp->text + start){
+        parseError(tp, start, "a term");
+        return -1;
+    }
+    *term = tp->text + start;
+    *termLength = (int) (comma - (tp->text + start));
+    tp->position = start + *termLength + 1;
+
+    *colour = parseColour(tp, "a colour", 0);
+    parseComma(tp);
+    *score = parseInt(tp, "a score");
+    parseRowEnd(tp);
+    return tp->failed ? -1 : 1;
+}
+
+int parseTransitionRow(struct tableParser *tp, int *prevColour, int *colour,
+    int *score){
+    if(tp->failed){
+        return -1;
+    }
+    skipLines(tp);
+    if(tp->position >= tp->length){
+        return 0;
+    }
+    *prevColour = parseColour(tp, "a preceding colour", INT_MIN);
+    parseComma(tp);
+    *colour = parseColour(tp, "a colour", INT_MIN);
+    parseComma(tp);
+    *score = parseInt(tp, "a score");
+    parseRowEnd(tp);
+    return tp->failed ? -1 : 1;
+}
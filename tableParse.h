@@ -0,0 +1,54 @@
+/*
+    Header for module which parses the rows of the term colour
+        table and colour transition table files in a single pass
+        over their text, reporting the line and column of any
+        malformed row.
+*/
+#include <stddef.h>
+
+/*
+    Most colours the tables can use, so colours run from 0 to
+    MAXCOLOURS - 1. Colours are kept in 16 bits in backpointers and
+    binary output, with UINT16_MAX left over to mark no colour.
+*/
+#define MAXCOLOURS 65535
+
+struct tableParser {
+    /* What is being parsed, for error messages (e.g. "table file"). */
+    const char *source;
+    const char *text;
+    size_t length;
+    /* Where the next row starts. */
+    size_t position;
+    /* Line of position, from 1, and where that line starts. */
+    int line;
+    size_t lineStart;
+    /* Set once a malformed row has been reported. */
+    int failed;
+};
+
+/*
+    Sets up the given parser over the length characters of text,
+    described as source in error messages.
+*/
+void newTableParser(struct tableParser *tp, const char *source, const char *text,
+    size_t length);
+
+/*
+    Parses the next term,colour,score row of a term colour table,
+    setting *term to the start of the term in the text and *termLength
+    to its length. Returns 0 once only whitespace is left. Returns -1
+    after reporting an error naming the line and column if the row is
+    malformed or its colour isn't from 0 to MAXCOLOURS - 1, leaving
+    the caller to give up on the table.
+*/
+int parseTableRow(struct tableParser *tp, const char **term, int *termLength,
+    int *colour, int *score);
+
+/*
+    Parses the next prevColour,colour,score row of a colour transition
+    table, as parseTableRow. Colours past MAXCOLOURS - 1 are errors,
+    while negative colours are left for the caller to skip.
+*/
+int parseTransitionRow(struct tableParser *tp, int *prevColour, int *colour,
+    int *score);
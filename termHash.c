@@ -0,0 +1,196 @@
+/*
+    Implementation for module which provides a hash index over
+        the terms in the term colour tables, keyed
+        case-insensitively on the term.
+
+    Uses open addressing with linear probing. Entries are never
+        removed, so a probe sequence ends at the first empty slot.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "termHash.h"
+
+/* Smallest number of slots to allocate. Must be a power of two. */
+#define INITIALSLOTS 64
+
+/* FNV-1a parameters. */
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+struct termHashEntry {
+    /* The term, or NULL if the slot is empty. */
+    const char *term;
+    /* Length of the term. */
+    int length;
+    /* Case-folded hash of the term. */
+    unsigned int hash;
+    /* Index of the table the term belongs to. */
+    int tableIndex;
+};
+
+struct termHash {
+    /* Number of slots, always a power of two. */
+    int slotCount;
+    /* Number of slots in use. */
+    int used;
+    struct termHashEntry *slots;
+};
+
+/* Hashes the first length characters of key, ignoring case. */
+static unsigned int foldedHash(const char *key, int length){
+    unsigned int hash = FNV_OFFSET;
+    for(int i = 0; i < length; i++){
+        hash ^= (unsigned char) tolower((unsigned char) key[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Places the given entry in the first free slot of its probe sequence. */
+static void placeEntry(struct termHash *h, struct termHashEntry *entry){
+    unsigned int mask = (unsigned int) h->slotCount - 1;
+    unsigned int slot = entry->hash & mask;
+    while(h->slots[slot].term){
+        slot = (slot + 1) & mask;
+    }
+    h->slots[slot] = *entry;
+}
+
+struct termHash *newTermHash(int expectedTerms){
+    struct termHash *h = (struct termHash *) malloc(sizeof(struct termHash));
+    assert(h);
+    h->slotCount = INITIALSLOTS;
+    /* Keep load factor at or below one half. */
+    while(h->slotCount < expectedTerms * 2){
+        h->slotCount *= 2;
+    }
+    h->used = 0;
+    h->slots = (struct termHashEntry *) calloc(h->slotCount, sizeof(struct termHashEntry));
+    assert(h->slots);
+    return h;
+}
+
+void termHashInsert(struct termHash *h, const char *term, int tableIndex){
+    if((h->used + 1) * 2 > h->slotCount){
+        /* Grow and re-place all entries. */
+        struct termHashEntry *oldSlots = h->slots;
+        int oldSlotCount = h->slotCount;
+        h->slotCount *= 2;
+        h->slots = (struct termHashEntry *) calloc(h->slotCount, sizeof(struct termHashEntry));
+        assert(h->slots);
+        for(int i = 0; i < oldSlotCount; i++){
+            if(oldSlots[i].term){
+                placeEntry(h, &oldSlots[i]);
+            }
+        }
+        free(oldSlots);
+    }
+    struct termHashEntry entry;
+    entry.term = term;
+    entry.length = strlen(term);
+    entry.hash = foldedHash(term, entry.length);
+    entry.tableIndex = tableIndex;
+    placeEntry(h, &entry);
+    h->used++;
+}
+
+int termHashFindFolded(struct termHash *h, const char *key, int length){
+    unsigned int hash = foldedHash(key, length);
+    unsigned int mask = (unsigned int) h->slotCount - 1;
+    int found = TERMHASH_NOT_FOUND;
+    /* Scan the whole probe sequence as terms differing in case may follow. */
+    for(unsigned int slot = hash & mask; h->slots[slot].term; slot = (slot + 1) & mask){
+        struct termHashEntry *e = &(h->slots[slot]);
+        if(e->hash != hash || e->length != length){
+            continue;
+        }
+        if(found != TERMHASH_NOT_FOUND && e->tableIndex >= found){
+            continue;
+        }
+        if(strncasecmp(e->term, key, length) == 0){
+            found = e->tableIndex;
+        }
+    }
+    return found;
+}
+
+int termHashFindExact(struct termHash *h, const char *key, int length){
+    unsigned int hash = foldedHash(key, length);
+    unsigned int mask = (unsigned int) h->slotCount - 1;
+    int found = TERMHASH_NOT_FOUND;
+    for(unsigned int slot = hash & mask; h->slots[slot].term; slot = (slot + 1) & mask){
+        struct termHashEntry *e = &(h->slots[slot]);
+        if(e->hash != hash || e->length != length){
+            continue;
+        }
+        if(found != TERMHASH_NOT_FOUND && e->tableIndex >= found){
+            continue;
+        }
+        if(strncmp(e->term, key, length) == 0){
+            found = e->tableIndex;
+        }
+    }
+    return found;
+}
+
+void writeTermHash(struct termHash *h, FILE *file){
+    int header[2] = { h->slotCount, h->used };
+    fwrite(header, sizeof(int), 2, file);
+    for(int i = 0; i < h->slotCount; i++){
+        struct termHashEntry *e = &(h->slots[i]);
+        /* Empty slots have no table. */
+        int slot[3] = { 0, 0, TERMHASH_NOT_FOUND };
+        if(e->term){
+            slot[0] = e->length;
+            slot[1] = (int) e->hash;
+            slot[2] = e->tableIndex;
+        }
+        fwrite(slot, sizeof(int), 3, file);
+    }
+}
+
+struct termHash *mapTermHash(const void *data, size_t length, const char *const *terms,
+    int termCount){
+    const int *header = (const int *) data;
+    const int *slot = header + 2;
+    if(length < sizeof(int) * 2 || header[0] < 0 ||
+        (size_t) header[0] > (length - sizeof(int) * 2) / (sizeof(int) * 3)){
+        return NULL;
+    }
+    for(int i = 0; i < header[0]; i++){
+        int tableIndex = slot[i * 3 + 2];
+        if(tableIndex != TERMHASH_NOT_FOUND && (tableIndex < 0 || tableIndex >= termCount)){
+            return NULL;
+        }
+    }
+    struct termHash *h = (struct termHash *) malloc(sizeof(struct termHash));
+    assert(h);
+    h->slotCount = header[0];
+    h->used = header[1];
+    h->slots = (struct termHashEntry *) calloc(h->slotCount, sizeof(struct termHashEntry));
+    assert(h->slots);
+    /* Entries stay in the slots they were written from. */
+    for(int i = 0; i < h->slotCount; i++, slot += 3){
+        if(slot[2] == TERMHASH_NOT_FOUND){
+            continue;
+        }
+        h->slots[i].term = terms[slot[2]];
+        h->slots[i].length = slot[0];
+        h->slots[i].hash = (unsigned int) slot[1];
+        h->slots[i].tableIndex = slot[2];
+    }
+    return h;
+}
+
+void freeTermHash(struct termHash *h){
+    if(h){
+        if(h->slots){
+            free(h->slots);
+        }
+        free(h);
+    }
+}
@@ -0,0 +1,60 @@
+/*
+    Header for module which provides a hash index over the
+        terms in the term colour tables, keyed case-insensitively
+        on the term.
+*/
+#include <stdio.h>
+
+struct termHash;
+
+/* Sentinel returned when no term in the index matches. */
+#define TERMHASH_NOT_FOUND (-1)
+
+/*
+    Creates an empty hash index with space for at least the given
+    number of terms before it needs to grow.
+*/
+struct termHash *newTermHash(int expectedTerms);
+
+/*
+    Adds the given term to the index, associated with the given
+    table index. The term string is not copied, so it must outlive
+    the index. Terms which differ only in case may all be added,
+    lookups then prefer the lowest table index.
+*/
+void termHashInsert(struct termHash *h, const char *term, int tableIndex);
+
+/*
+    Finds the lowest table index whose term matches the first length
+    characters of key, ignoring case. Returns TERMHASH_NOT_FOUND if
+    no term matches.
+*/
+int termHashFindFolded(struct termHash *h, const char *key, int length);
+
+/*
+    Finds the lowest table index whose term is exactly the first
+    length characters of key. Returns TERMHASH_NOT_FOUND if no term
+    matches.
+*/
+int termHashFindExact(struct termHash *h, const char *key, int length);
+
+/*
+    Writes the given hash index to the given file, in the form read
+    by mapTermHash. Terms are written as their table index rather 
+    than their spelling.
+*/
+void writeTermHash(struct termHash *h, FILE *file);
+
+/*
+    Rebuilds a hash index written by writeTermHash, starting at the
+    given data aligned to 4 bytes, without rehashing any term. The 
+    term for each table index is looked up in terms, which holds
+    termCount terms. The array can be freed afterwards, but the terms
+    must outlive the index. Returns NULL if the index doesn't fit in
+    the length bytes of data, or names a table past termCount.
+*/
+struct termHash *mapTermHash(const void *data, size_t length, const char *const *terms,
+    int termCount);
+
+/* Frees the given hash index and all memory allocated for it. */
+void freeTermHash(struct termHash *h);
@@ -0,0 +1,157 @@
+/*
+    Implementation for module which provides a case-folded trie
+        over the terms in the term colour tables.
+
+    Nodes live in a single array and refer to each other by index.
+        The children of a node are a singly linked list of siblings,
+        which keeps the trie small for large dictionaries while the
+        fan-out past the first few characters of a term stays low.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <ctype.h>
+#include "termTrie.h"
+
+/* Number of nodes to allocate space for initially. */
+#define INITIALNODES 256
+
+/* Index of the root node. */
+#define ROOT 0
+
+/* Marks the end of a sibling list or an absent child. */
+#define NO_NODE (-1)
+
+/* Marks nodes which don't end a term. */
+#define NO_TABLE (-1)
+
+struct termTrieNode {
+    /* The case-folded character on the edge into this node. */
+    unsigned char label;
+    /* First child of this node. */
+    int firstChild;
+    /* Next child of this node's parent. */
+    int nextSibling;
+    /* Table of the term ending at this node, or NO_TABLE. */
+    int tableIndex;
+};
+
+struct termTrie {
+    int nodeCount;
+    /* Zero if the nodes are mapped rather than allocated. */
+    int nodesAllocated;
+    struct termTrieNode *nodes;
+};
+
+/* Adds a fresh node and returns its index. */
+static int newNode(struct termTrie *t, unsigned char label){
+    /* Mapped tries can't grow. */
+    assert(t->nodesAllocated > 0);
+    if(t->nodeCount >= t->nodesAllocated){
+        t->nodes = (struct termTrieNode *) realloc(t->nodes, sizeof(struct termTrieNode) * t->nodesAllocated * 2);
+        assert(t->nodes);
+        t->nodesAllocated = t->nodesAllocated * 2;
+    }
+    struct termTrieNode *n = &(t->nodes[t->nodeCount]);
+    n->label = label;
+    n->firstChild = NO_NODE;
+    n->nextSibling = NO_NODE;
+    n->tableIndex = NO_TABLE;
+    t->nodeCount++;
+    return t->nodeCount - 1;
+}
+
+/* Finds the child of the given node along the given edge, or NO_NODE. */
+static int findChild(struct termTrie *t, int node, unsigned char label){
+    int child = t->nodes[node].firstChild;
+    while(child != NO_NODE && t->nodes[child].label != label){
+        child = t->nodes[child].nextSibling;
+    }
+    return child;
+}
+
+struct termTrie *newTermTrie(){
+    struct termTrie *t = (struct termTrie *) malloc(sizeof(struct termTrie));
+    assert(t);
+    t->nodes = (struct termTrieNode *) malloc(sizeof(struct termTrieNode) * INITIALNODES);
+    assert(t->nodes);
+    t->nodesAllocated = INITIALNODES;
+    t->nodeCount = 0;
+    newNode(t, '\0');
+    return t;
+}
+
+void termTrieInsert(struct termTrie *t, const char *term, int tableIndex){
+    int node = ROOT;
+    for(int i = 0; term[i] != '\0'; i++){
+        unsigned char label = (unsigned char) tolower((unsigned char) term[i]);
+        int child = findChild(t, node, label);
+        if(child == NO_NODE){
+            child = newNode(t, label);
+            /* Note node array may have moved, so index it afresh. */
+            t->nodes[child].nextSibling = t->nodes[node].firstChild;
+            t->nodes[node].firstChild = child;
+        }
+        node = child;
+    }
+    if(t->nodes[node].tableIndex == NO_TABLE){
+        t->nodes[node].tableIndex = tableIndex;
+    }
+}
+
+int termTrieLongestMatch(struct termTrie *t, const char *text, int length,
+    int *tableIndex){
+    int node = ROOT;
+    int matchLength = 0;
+    for(int i = 0; i < length; i++){
+        node = findChild(t, node, (unsigned char) tolower((unsigned char) text[i]));
+        if(node == NO_NODE){
+            break;
+        }
+        if(t->nodes[node].tableIndex != NO_TABLE &&
+            (i + 1 == length || ! isalpha((unsigned char) text[i + 1]))){
+            /* Term ends at a word boundary, longer than any before. */
+            matchLength = i + 1;
+            *tableIndex = t->nodes[node].tableIndex;
+        }
+    }
+    return matchLength;
+}
+
+void writeTermTrie(struct termTrie *t, FILE *file){
+    /* Padded so the nodes which follow stay aligned. */
+    int header[2] = { t->nodeCount, 0 };
+    fwrite(header, sizeof(int), 2, file);
+    fwrite(t->nodes, sizeof(struct termTrieNode), t->nodeCount, file);
+}
+
+struct termTrie *mapTermTrie(const void *data, size_t length, int termCount){
+    const int *header = (const int *) data;
+    if(length < sizeof(int) * 2 || header[0] < 1 ||
+        (size_t) header[0] > (length - sizeof(int) * 2) / sizeof(struct termTrieNode)){
+        return NULL;
+    }
+    const struct termTrieNode *nodes = (const struct termTrieNode *) (header + 2);
+    for(int i = 0; i < header[0]; i++){
+        if(nodes[i].firstChild < NO_NODE || nodes[i].firstChild >= header[0] ||
+            nodes[i].nextSibling < NO_NODE || nodes[i].nextSibling >= header[0] ||
+            nodes[i].tableIndex < NO_TABLE || nodes[i].tableIndex >= termCount){
+            return NULL;
+        }
+    }
+    struct termTrie *t = (struct termTrie *) malloc(sizeof(struct termTrie));
+    assert(t);
+    t->nodeCount = header[0];
+    t->nodesAllocated = 0;
+    t->nodes = (struct termTrieNode *) (header + 2);
+    return t;
+}
+
+void freeTermTrie(struct termTrie *t){
+    if(t){
+        if(t->nodes && t->nodesAllocated > 0){
+            free(t->nodes);
+        }
+        free(t);
+    }
+}
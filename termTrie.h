@@ -0,0 +1,46 @@
+/*
+    Header for module which provides a case-folded trie over
+        the terms in the term colour tables, used to find the
+        longest term starting at each point in the text.
+*/
+#include <stdio.h>
+
+struct termTrie;
+
+/* Creates an empty trie. */
+struct termTrie *newTermTrie();
+
+/*
+    Adds the given term to the trie, associated with the given table
+    index. If a term with the same case-folded spelling was already
+    added, the earlier table index is kept.
+*/
+void termTrieInsert(struct termTrie *t, const char *term, int tableIndex);
+
+/*
+    Finds the longest term matching the start of text, ignoring case,
+    which ends at a word boundary (a non-alphabetic character or the end
+    of the length characters given). Returns the length of the match and
+    sets *tableIndex to the table of the term matched, or returns 0 if no
+    term matches.
+*/
+int termTrieLongestMatch(struct termTrie *t, const char *text, int length,
+    int *tableIndex);
+
+/* 
+    Writes the given trie to the given file, in the form read by 
+    mapTermTrie.
+*/
+void writeTermTrie(struct termTrie *t, FILE *file);
+
+/*
+    Uses a trie written by writeTermTrie, starting at the given data
+    aligned to 8 bytes, in place. The data must outlive the trie, and
+    no terms can be added to it. Returns NULL if the trie doesn't fit
+    in the length bytes of data, or a node refers past the last node
+    or past the termCount tables.
+*/
+struct termTrie *mapTermTrie(const void *data, size_t length, int termCount);
+
+/* Frees the given trie and all memory allocated for it. */
+void freeTermTrie(struct termTrie *t);